@@ -1,7 +1,69 @@
 #include <pebble.h>
+#include "background.h"
+#include "digit_anim.h"
+#include "event_trace.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
+#include "time_format.h"
 
-#define KEY_TEMPERATURE 0
-#define KEY_CONDITIONS 1
+#define KEY_REQUEST 0  // watch asks the phone for weather, 1 if it has no report
+#define KEY_WEATHER 2  // packed weather report from the phone
+#define KEY_WEATHER_TIME 3  // new fetch time for an unchanged report
+
+// Packed weather report, one byte array tuple:
+// [0] format version, [1] WeatherCondition, [2] temperature in C as int8,
+// [3..6] fetch time in seconds since the epoch, little endian
+#define WEATHER_FORMAT_VERSION 1
+#define WEATHER_PACKED_SIZE 7
+
+// persistent storage keys
+#define PERSIST_KEY_WEATHER 0
+
+// cached weather older than this is marked as stale
+#define WEATHER_STALE_AGE (2 * SECONDS_PER_HOUR)
+
+// how often to refresh the weather, and how often on a low battery
+#define WEATHER_REFRESH_INTERVAL (30 * SECONDS_PER_MINUTE)
+#define WEATHER_LOW_BATTERY_INTERVAL (2 * SECONDS_PER_HOUR)
+#define WEATHER_LOW_BATTERY_PERCENT 20
+
+// give up on a reply after this long, then retry with exponential backoff
+#define WEATHER_REPLY_TIMEOUT (2 * SECONDS_PER_MINUTE)
+#define WEATHER_BACKOFF_MIN (2 * SECONDS_PER_MINUTE)
+#define WEATHER_BACKOFF_MAX (2 * SECONDS_PER_HOUR)
+
+// condition codes sent by the phone, in the same order as the JS table
+typedef enum {
+	CONDITION_UNKNOWN,
+	CONDITION_THUNDERSTORM,
+	CONDITION_DRIZZLE,
+	CONDITION_RAIN,
+	CONDITION_SNOW,
+	CONDITION_CLEAR,
+	CONDITION_CLOUDS,
+	CONDITION_MIST,
+	CONDITION_SMOKE,
+	CONDITION_HAZE,
+	CONDITION_DUST,
+	CONDITION_FOG,
+	CONDITION_SAND,
+	CONDITION_ASH,
+	CONDITION_SQUALL,
+	CONDITION_TORNADO,
+	CONDITION_COUNT
+} WeatherCondition;
+
+static const char *s_condition_names[CONDITION_COUNT] = {
+	"", "Thunderstorm", "Drizzle", "Rain", "Snow", "Clear", "Clouds", "Mist",
+	"Smoke", "Haze", "Dust", "Fog", "Sand", "Ash", "Squall", "Tornado"
+};
+
+// last weather report from the phone, kept packed in persistent storage
+typedef struct {
+	int8_t temperature;
+	uint8_t condition;
+	time_t timestamp;  // when the phone fetched the report, 0 if there is none
+} WeatherCache;
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
@@ -10,150 +72,298 @@ static Window *s_main_window;
 static GFont s_time_font;
 static GFont s_weather_font;
 
-// use a TextLayer element to add time and weather info to the Window
-static TextLayer *s_time_layer;
+// use a TextLayer element to add weather info to the Window
 static TextLayer *s_weather_layer;
 
-// Pointers for bitmap
-static BitmapLayer *s_background_layer;
-static GBitmap *s_background_bitmap;
+static WeatherCache s_weather;
+static bool s_weather_stale;
+
+// weather request scheduling
+static time_t s_request_sent;  // when the pending request went out, 0 if none
+static time_t s_retry_at;  // no requests before this after a failure
+static int s_backoff;  // current retry delay in seconds, 0 after a success
+static bool s_connected = true;  // last known phone connection state
+
+// text of the time, reformatted when the minute changes
+static TimeFormatter s_time_format;
 
 static void update_time() {
 	// Get a tm structure
 	time_t temp = time(NULL);
 	struct tm *tick_time = localtime(&temp);
 	
-	//Write the current hours and minutes into a buffer
-	static char s_buffer[8];
-	strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ? "%H:%M" : "%I:%M", tick_time);
+	// Write the hours and minutes only when they changed
+	if(time_format_update(&s_time_format, tick_time) & TIME_FORMAT_TIME) {
+		// Roll in the digits that changed, each marks only its own cell dirty
+		digit_anim_set_text(s_time_format.time);
+	}
+}
+
+static bool weather_is_stale() {
+	return time(NULL) - s_weather.timestamp > WEATHER_STALE_AGE;
+}
+
+// Refresh less often when the battery is low and not charging
+static int weather_interval() {
+	BatteryChargeState charge = battery_state_service_peek();
+	if(!charge.is_charging && charge.charge_percent <= WEATHER_LOW_BATTERY_PERCENT) {
+		return WEATHER_LOW_BATTERY_INTERVAL;
+	}
+	return WEATHER_REFRESH_INTERVAL;
+}
+
+// Back off exponentially after a request or its reply is lost
+static void weather_request_failed() {
+	s_request_sent = 0;
+	s_backoff = s_backoff ? MIN(s_backoff * 2, WEATHER_BACKOFF_MAX) : WEATHER_BACKOFF_MIN;
+	s_retry_at = time(NULL) + s_backoff;
+	APP_LOG(APP_LOG_LEVEL_WARNING, "Weather request failed, retrying in %ds", s_backoff);
+}
+
+// Clear the pending request and any backoff
+static void weather_request_done() {
+	s_request_sent = 0;
+	s_backoff = 0;
+	s_retry_at = 0;
+}
+
+static void request_weather() {
+	// Begin dictionary, the outbox may still be busy with the last message
+	DictionaryIterator *iter;
+	if(app_message_outbox_begin(&iter) != APP_MSG_OK) {
+		weather_request_failed();
+		return;
+	}
+	
+	// Add a key-value pair
+	dict_write_uint8(iter, KEY_REQUEST, s_weather.timestamp ? 0 : 1);
+	
+	// Send the message!
+	if(app_message_outbox_send() != APP_MSG_OK) {
+		weather_request_failed();
+		return;
+	}
+	s_request_sent = time(NULL);
+}
+
+// Ask the phone for weather once the cached report is due for a refresh,
+// with at most one request in flight and none while the phone is away
+static void schedule_weather() {
+	time_t now = time(NULL);
+	
+	// Wait for the pending reply, treating a timeout as a failure
+	if(s_request_sent) {
+		if(now - s_request_sent < WEATHER_REPLY_TIMEOUT) {
+			return;
+		}
+		weather_request_failed();
+	}
+	
+	if(!s_connected || now < s_retry_at) {
+		return;
+	}
+	
+	if(now - s_weather.timestamp >= weather_interval()) {
+		request_weather();
+	}
+}
+
+// Catch up straight away when the phone comes back instead of waiting out
+// the backoff
+static void weather_connection_changed(bool connected) {
+	bool reconnected = connected && !s_connected;
+	s_connected = connected;
+	
+	if(reconnected) {
+		weather_request_done();
+		schedule_weather();
+	}
+}
+
+// Unpack a weather report, rejecting short records and other format versions
+static bool weather_unpack(const uint8_t *data, uint16_t length, WeatherCache *weather) {
+	if(length < WEATHER_PACKED_SIZE || data[0] != WEATHER_FORMAT_VERSION) {
+		return false;
+	}
+	
+	weather->condition = data[1] < CONDITION_COUNT ? data[1] : CONDITION_UNKNOWN;
+	weather->temperature = (int8_t)data[2];
+	weather->timestamp = data[3] | data[4] << 8 | data[5] << 16 | (uint32_t)data[6] << 24;
+	return true;
+}
+
+static void weather_pack(const WeatherCache *weather, uint8_t *data) {
+	uint32_t timestamp = weather->timestamp;
+	
+	data[0] = WEATHER_FORMAT_VERSION;
+	data[1] = weather->condition;
+	data[2] = (uint8_t)weather->temperature;
+	data[3] = timestamp;
+	data[4] = timestamp >> 8;
+	data[5] = timestamp >> 16;
+	data[6] = timestamp >> 24;
+}
+
+// Keep the report for the next launch
+static void save_weather() {
+	uint8_t packed[WEATHER_PACKED_SIZE];
+	weather_pack(&s_weather, packed);
+	persist_write_data(PERSIST_KEY_WEATHER, packed, sizeof(packed));
+}
+
+// Show the cached weather, with a ? after the temperature once it is stale
+static void show_weather() {
+	static char weather_layer_buffer[32];
+	
+	// Nothing received yet
+	if(s_weather.timestamp == 0) {
+		return;
+	}
 	
-	// Display this time on the TextLayer
-	text_layer_set_text(s_time_layer, s_buffer);
+	s_weather_stale = weather_is_stale();
+	snprintf(weather_layer_buffer, sizeof(weather_layer_buffer), s_weather_stale ? "%dC?, %s" : "%dC, %s",
+		(int)s_weather.temperature, s_condition_names[s_weather.condition]);
+	background_mark_dirty(layer_get_frame(text_layer_get_layer(s_weather_layer)));
+	text_layer_set_text(s_weather_layer, weather_layer_buffer);
+}
+
+// Catch up on the weather when the phone reconnects
+static void connection_callback(bool connected) {
+	weather_connection_changed(connected);
 }
 
 // handler function
 static void main_window_load(Window *window) {
+	heap_trace_point(HEAP_LOAD_START);
+	
 	// Get information about the Window
 	Layer *window_layer = window_get_root_layer(window);
 	GRect bounds = layer_get_bounds(window_layer);
 	
-	// Create GBitmap - this needs to be before the TextLayer
-	s_background_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_BACKGROUND);
+	// Add the background first so it is under the TextLayer
+	HEAP_TRACE_CALL("background", background_load(window, RESOURCE_ID_BACKGROUND_RLE));
 	
-	// Create BitmapLayer to display the GBitmap
-	s_background_layer = bitmap_layer_create(bounds);
-	
-	// Set the bitmap onto the layer and add to the window
-	bitmap_layer_set_bitmap(s_background_layer, s_background_bitmap);
-	layer_add_child(window_layer, bitmap_layer_get_layer(s_background_layer));
-	
-	// Create the time TextLayer with specific bounds
-	s_time_layer = text_layer_create(
-		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50));
-	
-	// Improve the layout to be more like a watchface
-	text_layer_set_background_color(s_time_layer, GColorClear);
-	text_layer_set_text_color(s_time_layer, GColorBlack);
-
 	// Create temperature layer
-	s_weather_layer = text_layer_create(
-		GRect(0, PBL_IF_ROUND_ELSE(125,120), bounds.size.w, 25));
+	s_weather_layer = HEAP_TRACE_OBJECT("weather layer", text_layer_create(
+		GRect(0, PBL_IF_ROUND_ELSE(125,120), bounds.size.w, 25)));
 	
 	// Style text for temperature layer
 	text_layer_set_background_color(s_weather_layer, GColorClear);
 	text_layer_set_text_color(s_weather_layer, GColorWhite);
 	text_layer_set_text_alignment(s_weather_layer, GTextAlignmentCenter);
 	// text_layer_set_text(s_weather_layer, "Loading...");
-
+	
   // Create GFonts for time and for weather
-    s_time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_48));
-	s_weather_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_20));
-
-    // Apply fonts to TextLayer
-    text_layer_set_font(s_time_layer, s_time_font);
-    text_layer_set_font(s_weather_layer, s_weather_font);
+    s_time_font = HEAP_TRACE_OBJECT("time font",
+		fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_48)));
+	s_weather_font = HEAP_TRACE_OBJECT("weather font",
+		fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_20)));
 	
-	// text_layer_set_font(s_time_layer, fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD));   //previous font
-	text_layer_set_text_alignment(s_time_layer, GTextAlignmentCenter);
+    // Apply font to TextLayer
+    text_layer_set_font(s_weather_layer, s_weather_font);
 	
-	// Add child layers to the Window's root layer
-	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
+	// Add the time, a layer per digit so only the digits that change redraw,
+	// and the weather
+	digit_anim_load(window_layer, GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50), s_time_font,
+		GColorBlack, background_mark_dirty);
+	digit_anim_set_text(s_time_format.time);
 	layer_add_child(window_layer, text_layer_get_layer(s_weather_layer));
 	
 	update_time();
 	
+	// Restore the last weather report so it shows on the first frame
+	uint8_t packed[WEATHER_PACKED_SIZE];
+	int length = persist_read_data(PERSIST_KEY_WEATHER, packed, sizeof(packed));
+	if(length > 0) {
+		weather_unpack(packed, length, &s_weather);
+	}
+	show_weather();
+	
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
 static void main_window_unload(Window *window) {
-	// Destroy TextLayer
-	text_layer_destroy(s_time_layer);
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
+	
+	// Destroy the time and the weather TextLayer
+	digit_anim_unload();
 	text_layer_destroy(s_weather_layer);
 	
 	//Unload GFont
 	fonts_unload_custom_font(s_time_font);
 	fonts_unload_custom_font(s_weather_font);
 	
-	// Destroy GBitmap
-	gbitmap_destroy(s_background_bitmap);
+	// Destroy the background
+	background_unload();
 	
-	// Destroy BitmapLayer
-	bitmap_layer_destroy(s_background_layer);
+	heap_trace_point(HEAP_UNLOAD_END);
 }
 
 // start TickTimerService event service. struct tm contains the current time
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
 	update_time();
 	
-	// Get weather update every 30 minutes
-	if(tick_time->tm_min % 30 == 0) {
-		// Begin dictionary
-		DictionaryIterator *iter;
-		app_message_outbox_begin(&iter);
-		
-		// Add a key-value pair
-		dict_write_uint8(iter, 0,0);
-		
-		// Send the message!
-		app_message_outbox_send();
+	// Mark the weather once it goes out of date
+	if(s_weather.timestamp && weather_is_stale() != s_weather_stale) {
+		show_weather();
 	}
+	
+	// Get a weather update when one is due
+	schedule_weather();
 }
 
 // setting up callback functions for AppMessage
 static void inbox_received_callback(DictionaryIterator *iterator, void *context) {
 	
-	// Store incoming information from javascript weather
-	static char temperature_buffer[8];
-	static char conditions_buffer[32];
-	static char weather_layer_buffer[32];
+	// Read the weather from javascript, which only sends what changed
+	Tuple *weather_tuple = dict_find(iterator, KEY_WEATHER);
+	Tuple *time_tuple = dict_find(iterator, KEY_WEATHER_TIME);
 	
-	// Read tuples for data
-	Tuple *temp_tuple = dict_find(iterator, KEY_TEMPERATURE);
-	Tuple *conditions_tuple = dict_find(iterator, KEY_CONDITIONS);
-
-	// If all data is available, use it
-	if(temp_tuple && conditions_tuple) {
-	  snprintf(temperature_buffer, sizeof(temperature_buffer), "%dC", (int)temp_tuple->value->int32);
-	  snprintf(conditions_buffer, sizeof(conditions_buffer), "%s", conditions_tuple->value->cstring);
-	  
-  	  // Assemble full string and display
-  	  snprintf(weather_layer_buffer, sizeof(weather_layer_buffer), "%s, %s", temperature_buffer, conditions_buffer);
-  	  text_layer_set_text(s_weather_layer, weather_layer_buffer);
+	// A full report replaces the cached one
+	if(weather_tuple && weather_unpack(weather_tuple->value->data, weather_tuple->length, &s_weather)) {
+	  save_weather();
+	  show_weather();
+	  weather_request_done();
+	}
+	// Otherwise the weather is unchanged and only its fetch time moves on
+	else if(time_tuple && s_weather.timestamp) {
+	  s_weather.timestamp = time_tuple->value->uint32;
+	  save_weather();
+	  show_weather();
+	  weather_request_done();
 	}
 }
 
 // set up three callbacks for error messages
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
 	APP_LOG(APP_LOG_LEVEL_ERROR, "Message dropped!");
+	// Only a dropped reply to our request needs a retry, a dropped push from
+	// the phone leaves the schedule alone
+	if(s_request_sent) {
+		weather_request_failed();
+	}
 }
 static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
 	APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox send failed");
+	weather_request_failed();
 }
 static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "Outbox send success!");
 }
 
+// Something else may have drawn over the window while it was hidden
+static void main_window_appear(Window *window) {
+	background_invalidate();
+}
+
 static void init() {
+	// Read the 12/24 hour setting once
+	time_format_init(&s_time_format, '0');
+	
 	// Create main Window element and assign to pointer
 	s_main_window = window_create();
 	window_set_background_color(s_main_window, GColorBlack);
@@ -161,6 +371,7 @@ static void init() {
 	// set handlers to manage the elements inside the Window
 	window_set_window_handlers(s_main_window, (WindowHandlers) {
 		.load = main_window_load,
+		.appear = main_window_appear,
 		.unload = main_window_unload
 	});
 	
@@ -173,16 +384,28 @@ static void init() {
 	// Make sure the time is displayed from the start
 	update_time();
 	
+	// Register for phone connection updates
+	connection_service_subscribe((ConnectionHandlers) {
+	  .pebble_app_connection_handler = connection_callback
+	});
+	
 	// register callbacks for AppMessage
 	app_message_register_inbox_received(inbox_received_callback);
 	app_message_register_inbox_dropped(inbox_dropped_callback);
 	app_message_register_outbox_failed(outbox_failed_callback);
 	app_message_register_outbox_sent(outbox_sent_callback);
 	
-	// Open AppMessage
-	const int inbox_size = 128;
-	const int outbox_size = 128;
+	// Open AppMessage with buffers sized for the largest message each way
+	const int inbox_size = dict_calc_buffer_size(1, WEATHER_PACKED_SIZE);
+	const int outbox_size = dict_calc_buffer_size(1, sizeof(uint8_t));
 	app_message_open(inbox_size, outbox_size);
+	
+	// PebbleKit JS sends the weather when it starts, so wait for that reply
+	// before scheduling a request of our own
+	s_connected = connection_service_peek_pebble_app_connection();
+	if(s_connected) {
+		s_request_sent = time(NULL);
+	}
 }
 
 static void deinit() {
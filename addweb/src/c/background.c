@@ -0,0 +1,193 @@
+#include "background.h"
+
+// The background is a run-length encoded resource from tools/rle_background.py,
+// see there for the layout
+#define RLE_VERSION 1
+#define RLE_HEADER_SIZE 12
+#define RLE_PALETTE_SIZE 4
+#define RLE_ROW_BUFFER_SIZE 256  // longest encoded row, checked by the tool and on load
+
+static Layer *s_background_layer;
+
+static ResHandle s_resource;
+static GSize s_size;
+static uint8_t s_palette[RLE_PALETTE_SIZE];  // GColor8 values
+static uint16_t *s_row_offsets;  // where each row starts in the runs, height + 1 of them
+static uint32_t s_runs_start;
+
+// one encoded row, read from the resource as it is drawn
+static uint8_t s_runs[RLE_ROW_BUFFER_SIZE];
+
+// what needs redrawing on the next frame
+static GRect s_dirty;
+
+#ifdef BACKGROUND_CACHE
+// Smallest rect holding both, where an empty rect adds nothing
+static GRect rect_union(GRect a, GRect b) {
+	if(a.size.w == 0 || a.size.h == 0) {
+		return b;
+	}
+	if(b.size.w == 0 || b.size.h == 0) {
+		return a;
+	}
+	
+	int x0 = MIN(a.origin.x, b.origin.x);
+	int y0 = MIN(a.origin.y, b.origin.y);
+	int x1 = MAX(a.origin.x + a.size.w, b.origin.x + b.size.w);
+	int y1 = MAX(a.origin.y + a.size.h, b.origin.y + b.size.h);
+	return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+#endif
+
+// Read the header and row table, the runs stay in the resource
+static void load_header(uint32_t resource_id) {
+	uint8_t header[RLE_HEADER_SIZE];
+	
+	s_resource = resource_get_handle(resource_id);
+	if(resource_load_byte_range(s_resource, 0, header, sizeof(header)) != sizeof(header) ||
+			header[0] != 'R' || header[1] != 'L' || header[2] != RLE_VERSION ||
+			(header[3] != 1 && header[3] != 2)) {
+		APP_LOG(APP_LOG_LEVEL_ERROR, "Background is not a version %d RL resource", RLE_VERSION);
+		return;
+	}
+	
+	s_size = GSize(header[4] | header[5] << 8, header[6] | header[7] << 8);
+	memcpy(s_palette, header + 8, RLE_PALETTE_SIZE);
+	
+	size_t table_size = (s_size.h + 1) * sizeof(uint16_t);
+	s_row_offsets = malloc(table_size);
+	if(!s_row_offsets) {
+		return;
+	}
+	s_runs_start = RLE_HEADER_SIZE + table_size;
+	
+	// Every row has to fit the row buffer and lie inside the resource
+	bool valid = resource_load_byte_range(s_resource, RLE_HEADER_SIZE, (uint8_t *)s_row_offsets,
+		table_size) == table_size;
+	for(int y = 0; valid && y < s_size.h; y++) {
+		valid = s_row_offsets[y] <= s_row_offsets[y + 1] &&
+			s_row_offsets[y + 1] - s_row_offsets[y] <= RLE_ROW_BUFFER_SIZE;
+	}
+	if(!valid || s_runs_start + s_row_offsets[s_size.h] > resource_size(s_resource)) {
+		APP_LOG(APP_LOG_LEVEL_ERROR, "Background row table is damaged");
+		free(s_row_offsets);
+		s_row_offsets = NULL;
+	}
+}
+
+// Write pixels [x0, x1] of a row in one palette colour
+static void fill_span(uint8_t *data, int x0, int x1, uint8_t value, bool one_bit) {
+	if(!one_bit) {
+		memset(data + x0, value, x1 - x0 + 1);
+		return;
+	}
+	
+	for(int x = x0; x <= x1; x++) {
+		if(value) {
+			data[x / 8] |= 1 << (x % 8);
+		} else {
+			data[x / 8] &= ~(1 << (x % 8));
+		}
+	}
+}
+
+// Decode the rows of rect straight into the frame buffer, returning the
+// number of pixels written
+static int draw_rect(GContext *ctx, GRect rect) {
+	GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+	if(!frame_buffer) {
+		return 0;
+	}
+	
+	// Black and white screens get the palette as light or dark
+	bool one_bit = gbitmap_get_format(frame_buffer) == GBitmapFormat1Bit;
+	uint8_t values[RLE_PALETTE_SIZE];
+	for(int i = 0; i < RLE_PALETTE_SIZE; i++) {
+		uint8_t c = s_palette[i];
+		values[i] = one_bit ? ((c >> 4 & 3) + (c >> 2 & 3) + (c & 3) >= 5) : c;
+	}
+	
+	GRect bounds = gbitmap_get_bounds(frame_buffer);
+	int y0 = MAX(rect.origin.y, 0);
+	int y1 = MIN(rect.origin.y + rect.size.h, MIN(bounds.size.h, s_size.h));
+	int pixels = 0;
+	
+	for(int y = y0; y < y1; y++) {
+		// Round displays have shorter rows at the top and bottom
+		GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, y);
+		int x0 = MAX(rect.origin.x, row.min_x);
+		int x1 = MIN(rect.origin.x + rect.size.w - 1, MIN(row.max_x, s_size.w - 1));
+		if(x1 < x0) {
+			continue;
+		}
+		
+		size_t length = s_row_offsets[y + 1] - s_row_offsets[y];
+		resource_load_byte_range(s_resource, s_runs_start + s_row_offsets[y], s_runs, length);
+		
+		// Each byte is a palette index and a run length
+		int x = 0;
+		for(size_t i = 0; i < length && x <= x1; i++) {
+			int end = x + (s_runs[i] & 0x3F) + 1;
+			if(end > x0) {
+				fill_span(row.data, MAX(x, x0), MIN(end - 1, x1), values[s_runs[i] >> 6], one_bit);
+			}
+			x = end;
+		}
+		pixels += x1 - x0 + 1;
+	}
+	
+	graphics_release_frame_buffer(ctx, frame_buffer);
+	return pixels;
+}
+
+static void background_update_proc(Layer *layer, GContext *ctx) {
+	int pixels = 0;
+	
+	if(s_row_offsets && s_dirty.size.w && s_dirty.size.h) {
+		pixels = draw_rect(ctx, s_dirty);
+	}
+#ifdef BACKGROUND_CACHE
+	// The frame buffer keeps the rest from the last frame
+	s_dirty = GRectZero;
+#endif
+	
+#ifdef BACKGROUND_TRACE
+	APP_LOG(APP_LOG_LEVEL_DEBUG, "background touched %d pixels", pixels);
+#else
+	(void)pixels;
+#endif
+}
+
+void background_mark_dirty(GRect rect) {
+#ifdef BACKGROUND_CACHE
+	s_dirty = rect_union(s_dirty, rect);
+#endif
+}
+
+void background_invalidate() {
+	s_dirty = layer_get_bounds(s_background_layer);
+	layer_mark_dirty(s_background_layer);
+}
+
+void background_load(Window *window, uint32_t resource_id) {
+	Layer *window_layer = window_get_root_layer(window);
+	
+	load_header(resource_id);
+	s_background_layer = layer_create(layer_get_bounds(window_layer));
+	layer_set_update_proc(s_background_layer, background_update_proc);
+	layer_add_child(window_layer, s_background_layer);
+	
+	// Without the cache every frame draws the whole image
+	s_dirty = layer_get_bounds(s_background_layer);
+	
+#ifdef BACKGROUND_CACHE
+	// Keep the last frame in the frame buffer instead of clearing it
+	window_set_background_color(window, GColorClear);
+#endif
+}
+
+void background_unload() {
+	layer_destroy(s_background_layer);
+	free(s_row_offsets);
+	s_row_offsets = NULL;
+}
@@ -0,0 +1,286 @@
+#include "digit_anim.h"
+#include "event_trace.h"
+#include "heap_trace.h"
+
+static Layer *s_layer;
+static Layer *s_cells[DIGIT_ANIM_CELLS];  // one per character, clipping its roll
+static GFont s_font;
+static GColor s_color;
+static DigitAnimDirtyHandler s_dirty_handler;
+
+// the text shown and the text the rolling cells leave, padded with '\0'
+static char s_text[DIGIT_ANIM_CELLS + 1];
+static char s_old_text[DIGIT_ANIM_CELLS + 1];
+
+// the running transition
+static uint8_t s_rolling;  // bit per cell that rolls
+static int s_offset;  // pixels the new characters still have to rise, 0 once in place
+static uint32_t s_start_ms;
+static AppTimer *s_timer;
+
+// frame pacing
+static bool s_frame_pending;  // a frame was asked for and not drawn yet
+static uint32_t s_frame_draw_ms;  // drawing the last frame
+
+// this transition, and every transition since launch
+static int s_frames;
+static int s_skipped;
+static uint32_t s_draw_ms;
+static uint32_t s_total_transitions;
+static uint32_t s_total_frames;
+static uint32_t s_total_skipped;
+static uint32_t s_total_draw_ms;
+
+// milliseconds since the epoch, truncated to 32 bits. Only differences are used.
+static uint32_t now_ms() {
+	time_t seconds;
+	uint16_t millis;
+	time_ms(&seconds, &millis);
+	return (uint32_t)seconds * 1000 + millis;
+}
+
+static bool battery_allows() {
+	BatteryChargeState state = battery_state_service_peek();
+	return state.is_charging || state.is_plugged || state.charge_percent > DIGIT_ANIM_MIN_PERCENT;
+}
+
+static int glyph_width(char c) {
+	char glyph[2] = { c, '\0' };
+	return graphics_text_layout_get_content_size(glyph, s_font, layer_get_bounds(s_layer),
+		GTextOverflowModeFill, GTextAlignmentLeft).w;
+}
+
+// A cell per character as wide as its glyph, the whole text centred like a
+// TextLayer centres it. A space measures as nothing on its own, so the
+// spaces share what the whole text measures beyond the other glyphs.
+static void layout(GRect cells[]) {
+	GRect bounds = layer_get_bounds(s_layer);
+	int widths[DIGIT_ANIM_CELLS];
+	int glyphs = 0;
+	int spaces = 0;
+	
+	for(int i = 0; i < DIGIT_ANIM_CELLS; i++) {
+		widths[i] = s_text[i] && s_text[i] != ' ' ? glyph_width(s_text[i]) : 0;
+		glyphs += widths[i];
+		spaces += s_text[i] == ' ';
+	}
+	
+	int total = glyphs;
+	if(spaces) {
+		int text = graphics_text_layout_get_content_size(s_text, s_font, bounds,
+			GTextOverflowModeFill, GTextAlignmentLeft).w;
+		int space = MAX(text - glyphs, 0) / spaces;
+		for(int i = 0; i < DIGIT_ANIM_CELLS; i++) {
+			if(s_text[i] == ' ') {
+				widths[i] = space;
+			}
+		}
+		total += space * spaces;
+	}
+	
+	int x = (bounds.size.w - total) / 2;
+	for(int i = 0; i < DIGIT_ANIM_CELLS; i++) {
+		cells[i] = GRect(x, 0, widths[i], bounds.size.h);
+		x += widths[i];
+	}
+}
+
+// Redraw a cell, and tell the parent which part of it changes
+static void mark_cell_dirty(int index) {
+	if(s_dirty_handler) {
+		GPoint origin = layer_get_frame(s_layer).origin;
+		GRect frame = layer_get_frame(s_cells[index]);
+		frame.origin.x += origin.x;
+		frame.origin.y += origin.y;
+		s_dirty_handler(frame);
+	}
+	layer_mark_dirty(s_cells[index]);
+}
+
+static void mark_rolling_dirty() {
+	for(int i = 0; i < DIGIT_ANIM_CELLS; i++) {
+		if(s_rolling & (1 << i)) {
+			mark_cell_dirty(i);
+		}
+	}
+}
+
+static void draw_glyph(GContext *ctx, char c, GRect bounds, int y) {
+	char glyph[2] = { c, '\0' };
+	graphics_draw_text(ctx, glyph, s_font, GRect(0, y, bounds.size.w, bounds.size.h),
+		GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+}
+
+// The old character rises out of the top of the cell as the new one comes
+// in from the bottom
+static void cell_update_proc(Layer *layer, GContext *ctx) {
+	uint32_t start_ms = now_ms();
+	int index = *(int *)layer_get_data(layer);
+	GRect bounds = layer_get_bounds(layer);
+	bool rolling = s_offset && (s_rolling & (1 << index));
+	
+	graphics_context_set_text_color(ctx, s_color);
+	if(rolling) {
+		draw_glyph(ctx, s_old_text[index], bounds, s_offset - bounds.size.h);
+	}
+	draw_glyph(ctx, s_text[index], bounds, rolling ? s_offset : 0);
+	
+	if(s_rolling) {
+		if(s_frame_pending) {
+			s_frame_pending = false;
+			s_frames++;
+		}
+		uint32_t elapsed = now_ms() - start_ms;
+		s_frame_draw_ms += elapsed;
+		s_draw_ms += elapsed;
+	}
+}
+
+static void end_transition() {
+	s_rolling = 0;
+	
+	s_total_transitions++;
+	s_total_frames += s_frames;
+	s_total_skipped += s_skipped;
+	s_total_draw_ms += s_draw_ms;
+#ifdef DIGIT_ANIM_TRACE
+	APP_LOG(APP_LOG_LEVEL_DEBUG, "Digit roll: %d frames, %d skipped, %lums drawing",
+		s_frames, s_skipped, (unsigned long)s_draw_ms);
+#endif
+}
+
+static void frame_callback(void *data) {
+	s_timer = NULL;
+	
+	// The last frame has been drawn
+	if(s_offset == 0) {
+		end_transition();
+		return;
+	}
+	
+	// Ease out, quick at first and then settling into place
+	uint32_t elapsed = now_ms() - s_start_ms;
+	uint32_t left = elapsed < DIGIT_ANIM_DURATION ? DIGIT_ANIM_DURATION - elapsed : 0;
+	s_offset = layer_get_bounds(s_layer).size.h * left * left / (DIGIT_ANIM_DURATION * DIGIT_ANIM_DURATION);
+	
+	// A frame that was never drawn is replaced by this one, and a frame
+	// that ran over budget takes the slots of the frames after it
+	int late = s_frame_draw_ms / DIGIT_ANIM_FRAME_MS;
+	s_skipped += late + s_frame_pending;
+	s_frame_draw_ms = 0;
+	s_frame_pending = true;
+	mark_rolling_dirty();
+	
+	s_timer = app_timer_register((late + 1) * DIGIT_ANIM_FRAME_MS, frame_callback, NULL);
+}
+
+// Jump to the end of a running transition
+static void finish_transition() {
+	if(!s_timer) {
+		return;
+	}
+	app_timer_cancel(s_timer);
+	s_timer = NULL;
+	
+	if(s_offset) {
+		s_offset = 0;
+		mark_rolling_dirty();
+	}
+	end_transition();
+}
+
+void digit_anim_load(Layer *parent, GRect frame, GFont font, GColor color, DigitAnimDirtyHandler handler) {
+	s_font = font;
+	s_color = color;
+	s_dirty_handler = handler;
+	memset(s_text, 0, sizeof(s_text));
+	s_rolling = 0;
+	s_offset = 0;
+	
+	s_layer = HEAP_TRACE_OBJECT("digit layer", layer_create(frame));
+	for(int i = 0; i < DIGIT_ANIM_CELLS; i++) {
+		s_cells[i] = HEAP_TRACE_OBJECT("digit cell", layer_create_with_data(GRectZero, sizeof(int)));
+		*(int *)layer_get_data(s_cells[i]) = i;
+		layer_set_update_proc(s_cells[i], cell_update_proc);
+		layer_add_child(s_layer, s_cells[i]);
+	}
+	layer_add_child(parent, s_layer);
+}
+
+void digit_anim_unload() {
+	if(s_timer) {
+		app_timer_cancel(s_timer);
+		s_timer = NULL;
+	}
+	s_rolling = 0;
+	s_offset = 0;
+	
+	for(int i = DIGIT_ANIM_CELLS - 1; i >= 0; i--) {
+		layer_destroy(s_cells[i]);
+	}
+	layer_destroy(s_layer);
+}
+
+void digit_anim_set_text(const char *text) {
+	if(strncmp(text, s_text, DIGIT_ANIM_CELLS) == 0) {
+		return;
+	}
+	finish_transition();
+	
+	memcpy(s_old_text, s_text, sizeof(s_text));
+	strncpy(s_text, text, DIGIT_ANIM_CELLS);
+	
+	// Nothing rolls in on the first text or out to an empty one
+	bool animate = s_old_text[0] && s_text[0] && battery_allows();
+	
+	GRect cells[DIGIT_ANIM_CELLS];
+	layout(cells);
+	for(int i = 0; i < DIGIT_ANIM_CELLS; i++) {
+		GRect frame = layer_get_frame(s_cells[i]);
+		bool moved = !grect_equal(&frame, &cells[i]);
+		bool changed = s_old_text[i] != s_text[i];
+		if(!moved && !changed) {
+			continue;
+		}
+		
+		// Clear where a cell that moves used to be
+		if(moved) {
+			mark_cell_dirty(i);
+			layer_set_frame(s_cells[i], cells[i]);
+		}
+		if(animate && changed && s_old_text[i] && s_text[i]) {
+			s_rolling |= 1 << i;
+		} else {
+			mark_cell_dirty(i);
+		}
+	}
+	
+	// The first frame is the old text, so the roll starts a frame later
+	if(s_rolling) {
+		s_offset = layer_get_bounds(s_layer).size.h;
+		s_start_ms = now_ms();
+		s_frames = 0;
+		s_skipped = 0;
+		s_draw_ms = 0;
+		s_frame_draw_ms = 0;
+		s_frame_pending = false;
+		s_timer = app_timer_register(DIGIT_ANIM_FRAME_MS, frame_callback, NULL);
+	}
+}
+
+bool digit_anim_running() {
+	return s_timer != NULL;
+}
+
+void digit_anim_log() {
+	uint32_t transitions = MAX(s_total_transitions, 1);
+	uint32_t frames_x10 = s_total_frames * 10 / transitions;
+	uint32_t draw_x10 = s_total_draw_ms * 10 / transitions;
+	
+	APP_LOG(APP_LOG_LEVEL_INFO, "digit anim: transitions=%lu frames=%lu skipped=%lu draw=%lums, "
+		"per transition frames=%lu.%lu draw=%lu.%lums",
+		(unsigned long)s_total_transitions, (unsigned long)s_total_frames,
+		(unsigned long)s_total_skipped, (unsigned long)s_total_draw_ms,
+		(unsigned long)(frames_x10 / 10), (unsigned long)(frames_x10 % 10),
+		(unsigned long)(draw_x10 / 10), (unsigned long)(draw_x10 % 10));
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <pebble.h>
+
+// Draws the time with a layer per character, and when the time changes
+// rolls only the characters that differ up into place. Each frame is given
+// DIGIT_ANIM_FRAME_MS: the roll follows the clock, so a frame that draws
+// for longer than that pushes back the next one and the frames in between
+// are skipped. Below DIGIT_ANIM_MIN_PERCENT, unless charging, the new
+// time shows at once.
+#define DIGIT_ANIM_DURATION 400  // ms per transition
+#define DIGIT_ANIM_FRAME_MS 40
+#define DIGIT_ANIM_MIN_PERCENT 20
+
+// Uncomment to log the frames of each transition as it ends
+// #define DIGIT_ANIM_TRACE
+
+// characters of the longest time, "12:34"
+#define DIGIT_ANIM_CELLS 5
+
+// Called with each area of the parent layer that is about to change
+typedef void (*DigitAnimDirtyHandler)(GRect rect);
+
+// Add the time over whatever the parent draws, centred in frame. The
+// handler may be NULL.
+void digit_anim_load(Layer *parent, GRect frame, GFont font, GColor color, DigitAnimDirtyHandler handler);
+void digit_anim_unload(void);
+
+// Show new text, rolling in the characters that changed
+void digit_anim_set_text(const char *text);
+
+// A transition is still running
+bool digit_anim_running(void);
+
+// Log the frames drawn, skipped and the time spent drawing, in total and
+// per transition
+void digit_anim_log(void);
@@ -0,0 +1,99 @@
+#include "time_format.h"
+
+#if TIME_FORMAT_LANGUAGE == TIME_FORMAT_DE
+static const char *const s_day_names[7] = {
+	"Sonntag", "Montag", "Dienstag", "Mittwoch", "Donnerstag", "Freitag", "Samstag"
+};
+static const char *const s_month_names[12] = {
+	"Januar", "Februar", "März", "April", "Mai", "Juni",
+	"Juli", "August", "September", "Oktober", "November", "Dezember"
+};
+#elif TIME_FORMAT_LANGUAGE == TIME_FORMAT_FR
+static const char *const s_day_names[7] = {
+	"dimanche", "lundi", "mardi", "mercredi", "jeudi", "vendredi", "samedi"
+};
+static const char *const s_month_names[12] = {
+	"janvier", "février", "mars", "avril", "mai", "juin",
+	"juillet", "août", "septembre", "octobre", "novembre", "décembre"
+};
+#elif TIME_FORMAT_LANGUAGE == TIME_FORMAT_ES
+static const char *const s_day_names[7] = {
+	"domingo", "lunes", "martes", "miércoles", "jueves", "viernes", "sábado"
+};
+static const char *const s_month_names[12] = {
+	"enero", "febrero", "marzo", "abril", "mayo", "junio",
+	"julio", "agosto", "septiembre", "octubre", "noviembre", "diciembre"
+};
+#else
+static const char *const s_day_names[7] = {
+	"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+static const char *const s_month_names[12] = {
+	"January", "February", "March", "April", "May", "June",
+	"July", "August", "September", "October", "November", "December"
+};
+#endif
+
+static bool s_clock_24h;
+
+// Two digits, the tens replaced by pad when they are 0
+static char *put_digits(char *text, int value, char pad) {
+	*text++ = value >= 10 ? '0' + value / 10 : pad;
+	*text++ = '0' + value % 10;
+	return text;
+}
+
+static void format_time(TimeFormatter *formatter, const struct tm *tick_time) {
+	int hour = tick_time->tm_hour;
+	char pad = '0';
+	if(!s_clock_24h) {
+		hour = hour % 12 ? hour % 12 : 12;
+		pad = formatter->pad;
+	}
+	
+	char *text = put_digits(formatter->time, hour, pad);
+	*text++ = ':';
+	text = put_digits(text, tick_time->tm_min, '0');
+	*text = '\0';
+}
+
+static void format_date(TimeFormatter *formatter, const struct tm *tick_time) {
+	snprintf(formatter->day, sizeof(formatter->day), "%s", s_day_names[tick_time->tm_wday]);
+	
+	// The month, then the day of the month padded with a space like %e
+	const char *month = s_month_names[tick_time->tm_mon];
+	int length = strlen(month);
+	memcpy(formatter->date, month, length);
+	char *text = formatter->date + length;
+	*text++ = ' ';
+	text = put_digits(text, tick_time->tm_mday, ' ');
+	*text = '\0';
+}
+
+void time_format_init(TimeFormatter *formatter, char pad) {
+	s_clock_24h = clock_is_24h_style();
+	*formatter = (TimeFormatter) {
+		.pad = pad,
+		.minute = -1,
+		.day_number = -1
+	};
+}
+
+int time_format_update(TimeFormatter *formatter, const struct tm *tick_time) {
+	int changed = 0;
+	
+	int minute = tick_time->tm_hour * MINUTES_PER_HOUR + tick_time->tm_min;
+	if(minute != formatter->minute) {
+		formatter->minute = minute;
+		format_time(formatter, tick_time);
+		changed |= TIME_FORMAT_TIME;
+	}
+	
+	int day_number = tick_time->tm_year * 366 + tick_time->tm_yday;
+	if(day_number != formatter->day_number) {
+		formatter->day_number = day_number;
+		format_date(formatter, tick_time);
+		changed |= TIME_FORMAT_DAY | TIME_FORMAT_DATE;
+	}
+	return changed;
+}
@@ -2,6 +2,13 @@
 var shared = require('../../app-env');
 var specialKey = shared.test();
 
+// Packed weather report format understood by the watch
+var WEATHER_FORMAT_VERSION = 1;
+
+// Condition codes sent to the watch, the index matches WeatherCondition in C
+var CONDITIONS = ['', 'Thunderstorm', 'Drizzle', 'Rain', 'Snow', 'Clear', 'Clouds', 'Mist',
+	'Smoke', 'Haze', 'Dust', 'Fog', 'Sand', 'Ash', 'Squall', 'Tornado'];
+
 var xhrRequest = function (url, type, callback) {
 	var xhr = new XMLHttpRequest();
 	xhr.onload = function () {
@@ -11,8 +18,87 @@ var xhrRequest = function (url, type, callback) {
 	xhr.send();
 };
 
+// Pack a weather report into the byte array the watch expects:
+// version, condition code, temperature as int8, fetch time as uint32 little endian
+function packWeather(temperature, conditions, timestamp) {
+	var condition = CONDITIONS.indexOf(conditions);
+	if (condition < 0) {
+		condition = 0;
+	}
+	
+	var temp = Math.max(-128, Math.min(127, temperature));
+	
+	return [
+		WEATHER_FORMAT_VERSION,
+		condition,
+		temp & 0xFF,
+		timestamp & 0xFF,
+		(timestamp >> 8) & 0xFF,
+		(timestamp >> 16) & 0xFF,
+		(timestamp >>> 24) & 0xFF
+	];
+}
+
+// Last report the watch acknowledged, so unchanged weather is not sent again
+var LAST_SENT_KEY = 'lastSent';
+
+function readLastSent() {
+	try {
+		return JSON.parse(localStorage.getItem(LAST_SENT_KEY));
+	} catch (e) {
+		return null;
+	}
+}
+
+// Make the next send a full report, for a watch that may have lost its copy
+function forgetLastSent() {
+	localStorage.removeItem(LAST_SENT_KEY);
+}
 
-function locationSuccess(pos) { 
+// Send a report, or nothing when the watch already has it. requested is
+// true when the watch asked for it.
+function sendWeather(weather, requested) {
+	var timestamp = Math.floor(weather.time / 1000);
+	var last = readLastSent();
+	var dictionary;
+	
+	// Only send what the watch does not already have
+	if (last && last.temperature === weather.temperature && last.conditions === weather.conditions) {
+		// A watch that asked waits for an answer and backs off without one,
+		// so it gets its own timestamp back
+		if (last.timestamp === timestamp && !requested) {
+			console.log('Watch already has this weather');
+			return;
+		}
+		
+		// Same weather, newer fetch: just move the watch's timestamp on
+		dictionary = {
+			"KEY_WEATHER_TIME": timestamp
+		};
+	} else {
+		// Assemble dictionary using our keys
+		dictionary = {
+			"KEY_WEATHER": packWeather(weather.temperature, weather.conditions, timestamp)
+		};
+	}
+	
+	// Send to Pebble
+	Pebble.sendAppMessage(dictionary,
+		function(e) {
+			localStorage.setItem(LAST_SENT_KEY, JSON.stringify({
+				temperature: weather.temperature,
+				conditions: weather.conditions,
+				timestamp: timestamp
+			}));
+			console.log("Weather info sent to Pebble successfully!");
+		},
+		function(e) {
+			console.log("Error sending weather info to Pebble!");
+		}
+	);
+}
+
+function locationSuccess(pos, requested) { 
 	// Construct URL
 	var url = 'http://api.openweathermap.org/data/2.5/weather?lat=' + pos.coords.latitude + '&lon=' + pos.coords.longitude + '&appid=' + specialKey;
 	
@@ -30,21 +116,11 @@ function locationSuccess(pos) {
 			var conditions = json.weather[0].main;
 			console.log('Conditions are ' + conditions);
 			
-			// Assemble dictionary using our keys
-			var dictionary = {
-				"KEY_TEMPERATURE": temperature,
-				"KEY_CONDITIONS": conditions
-			};
-			
-			// Send to Pebble
-			Pebble.sendAppMessage(dictionary,
-				function(e) {
-					console.log("Weather info sent to Pebble successfully!");
-				},
-				function(e) {
-					console.log("Error sending weather info to Pebble!");
-				}
-			);
+			sendWeather({
+				time: Date.now(),
+				temperature: temperature,
+				conditions: conditions
+			}, requested);
 		}
 	);
 }
@@ -53,17 +129,27 @@ function locationError(err) {
 	console.log('Error requesting location!');
 }
 
-function getWeather() {
+// requested is true when the watch asked for the weather
+function getWeather(requested) {
 	navigator.geolocation.getCurrentPosition(
-		locationSuccess,
+		function(pos) {
+			locationSuccess(pos, requested);
+		},
 		locationError,
 		{timeout: 15000, maximumAge: 60000}
 	);
 }
 
-// Listen for when the watchface is opened
-Pebble.addEventListener('ready', function(e) { console.log('PebbleKit JS ready!'); getWeather(); } );
+// Listen for when the watchface is opened, and send it a full report
+Pebble.addEventListener('ready', function(e) { console.log('PebbleKit JS ready!'); forgetLastSent(); getWeather(); } );
 
 // Listen for when an AppMessage is received 
-Pebble.addEventListener('appmessage', function(e) { console.log('AppMessage received!'); getWeather(); } );
-	
\ No newline at end of file
+Pebble.addEventListener('appmessage', function(e) {
+	console.log('AppMessage received!');
+	
+	// The watch asks for a full report when it has none cached
+	if (e.payload.KEY_REQUEST === 1) {
+		forgetLastSent();
+	}
+	getWeather(true);
+} );
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include <pebble.h>
+#include "event_trace.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
@@ -8,13 +11,15 @@ static TextLayer *s_time_layer;
 
 // handler function
 static void main_window_load(Window *window) {
+	heap_trace_point(HEAP_LOAD_START);
+	
 	// Get information about the Window
 	Layer *window_layer = window_get_root_layer(window);
 	GRect bounds = layer_get_bounds(window_layer);
 	
 	// Create the TextLayer with specific bounds
-	s_time_layer = text_layer_create(
-		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50));
+	s_time_layer = HEAP_TRACE_OBJECT("time layer", text_layer_create(
+		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50)));
 	
 	// Improve the layout to be more like a watchface
 	text_layer_set_background_color(s_time_layer, GColorClear);
@@ -25,12 +30,21 @@ static void main_window_load(Window *window) {
 	
 	// Add it as a child layer to the Window's root layer
 	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
+	
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
 static void main_window_unload(Window *window) {
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
+	
 	// Destroy TextLayer
 	text_layer_destroy(s_time_layer);
+	
+	heap_trace_point(HEAP_UNLOAD_END);
 }
 
 static void init() {
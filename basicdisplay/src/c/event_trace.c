@@ -0,0 +1,422 @@
+#include "event_trace.h"
+
+#if defined(EVENT_TRACE_RECORD) || defined(EVENT_TRACE_REPLAY)
+
+// The real services, the face reaches them through the trace
+#undef tick_timer_service_subscribe
+#undef battery_state_service_subscribe
+#undef connection_service_subscribe
+#undef accel_tap_service_subscribe
+#undef app_message_register_inbox_received
+
+static TickHandler s_tick_handler;
+static BatteryStateHandler s_battery_handler;
+static ConnectionHandler s_connection_handler;
+static AccelTapHandler s_tap_handler;
+static AppMessageInboxReceived s_inbox_handler;
+
+#endif
+
+#ifdef EVENT_TRACE_RECORD
+
+// bytes logged per line, as hex
+#define EVENT_TRACE_LINE_BYTES 32
+
+static uint8_t s_line[EVENT_TRACE_LINE_BYTES];
+static int s_line_length;
+
+// numbered so lines lost by the log can be noticed
+static uint8_t s_line_number;
+
+static bool s_started;
+static time_t s_last_event;
+
+static void flush_line() {
+	if(s_line_length == 0) {
+		return;
+	}
+	
+	char hex[EVENT_TRACE_LINE_BYTES * 2 + 1];
+	for(int i = 0; i < s_line_length; i++) {
+		snprintf(hex + 2 * i, 3, "%02x", s_line[i]);
+	}
+	APP_LOG(APP_LOG_LEVEL_INFO, "event trace %02x %s", s_line_number++, hex);
+	s_line_length = 0;
+}
+
+static void put_byte(uint8_t value) {
+	s_line[s_line_length++] = value;
+	if(s_line_length == EVENT_TRACE_LINE_BYTES) {
+		flush_line();
+	}
+}
+
+static void put16(uint16_t value) {
+	put_byte(value);
+	put_byte(value >> 8);
+}
+
+static void put32(uint32_t value) {
+	put16(value);
+	put16(value >> 16);
+}
+
+static void put_varint(uint32_t value) {
+	while(value >= 0x80) {
+		put_byte(value | 0x80);
+		value >>= 7;
+	}
+	put_byte(value);
+}
+
+static void begin_event(EventType type) {
+	time_t now = time(NULL);
+	
+	// The first event starts the trace
+	if(!s_started) {
+		s_started = true;
+		s_last_event = now;
+		put_byte('E');
+		put_byte('T');
+		put_byte(EVENT_TRACE_FORMAT_VERSION);
+		put_byte(EVENT_START);
+		put_varint(0);
+		put32(now);
+	}
+	
+	put_byte(type);
+	put_varint(MAX(now - s_last_event, 0));
+	s_last_event = now;
+}
+
+// Every event is logged whole, nothing is lost when the app exits
+static void end_event() {
+	flush_line();
+}
+
+static void tick_recorder(struct tm *tick_time, TimeUnits units_changed) {
+	begin_event(EVENT_TICK);
+	put_byte(units_changed);
+	put_byte(tick_time->tm_sec);
+	put_byte(tick_time->tm_min);
+	put_byte(tick_time->tm_hour);
+	put_byte(tick_time->tm_mday);
+	put_byte(tick_time->tm_mon);
+	put_byte(tick_time->tm_year);
+	put_byte(tick_time->tm_wday);
+	put16(tick_time->tm_yday);
+	end_event();
+	
+	s_tick_handler(tick_time, units_changed);
+}
+
+static void battery_recorder(BatteryChargeState state) {
+	begin_event(EVENT_BATTERY);
+	put_byte(state.charge_percent);
+	put_byte((state.is_charging ? 1 : 0) | (state.is_plugged ? 2 : 0));
+	end_event();
+	
+	s_battery_handler(state);
+}
+
+static void connection_recorder(bool connected) {
+	begin_event(EVENT_CONNECTION);
+	put_byte(connected);
+	end_event();
+	
+	s_connection_handler(connected);
+}
+
+static void tap_recorder(AccelAxisType axis, int32_t direction) {
+	begin_event(EVENT_TAP);
+	put_byte(axis);
+	put_byte(direction);
+	end_event();
+	
+	s_tap_handler(axis, direction);
+}
+
+static void inbox_recorder(DictionaryIterator *iterator, void *context) {
+	const uint8_t *data = (const uint8_t *)iterator->dictionary;
+	uint16_t length = (const uint8_t *)iterator->end - data;
+	
+	begin_event(EVENT_INBOX);
+	put16(length);
+	for(int i = 0; i < length; i++) {
+		put_byte(data[i]);
+	}
+	end_event();
+	
+	s_inbox_handler(iterator, context);
+}
+
+void event_trace_tick_subscribe(TimeUnits units, TickHandler handler) {
+	s_tick_handler = handler;
+	tick_timer_service_subscribe(units, tick_recorder);
+}
+
+void event_trace_battery_subscribe(BatteryStateHandler handler) {
+	s_battery_handler = handler;
+	battery_state_service_subscribe(battery_recorder);
+}
+
+// Only the phone app connection is recorded
+void event_trace_connection_subscribe(ConnectionHandlers handlers) {
+	s_connection_handler = handlers.pebble_app_connection_handler;
+	if(s_connection_handler) {
+		handlers.pebble_app_connection_handler = connection_recorder;
+	}
+	connection_service_subscribe(handlers);
+}
+
+void event_trace_tap_subscribe(AccelTapHandler handler) {
+	s_tap_handler = handler;
+	accel_tap_service_subscribe(tap_recorder);
+}
+
+void event_trace_inbox_register(AppMessageInboxReceived handler) {
+	s_inbox_handler = handler;
+	app_message_register_inbox_received(inbox_recorder);
+}
+
+#endif
+
+#ifdef EVENT_TRACE_REPLAY
+
+#undef text_layer_set_text
+#undef layer_mark_dirty
+#undef time
+
+// static const uint8_t s_event_trace[], see tools/event_trace.py
+#include "event_trace_data.h"
+
+// wait for the window to draw before the first event
+#define EVENT_TRACE_START_DELAY_MS 1000
+
+// gap between events, so the face gets to draw in between
+#define EVENT_TRACE_STEP_MS 10
+
+// size of the header and the start event
+#define EVENT_TRACE_HEADER_SIZE 9
+
+static const char *s_event_names[EVENT_TYPE_COUNT] = {
+	"start", "tick", "battery", "connection", "tap", "inbox"
+};
+
+typedef struct {
+	int calls;
+	uint32_t total_ms;
+	uint32_t max_ms;
+} EventStats;
+
+static EventStats s_stats[EVENT_TYPE_COUNT];
+static int s_set_text_count;
+static int s_mark_dirty_count;
+
+// the next event, NULL until the trace has been read
+static const uint8_t *s_cursor;
+static time_t s_now;
+static bool s_replaying;
+static uint32_t s_replay_start;
+
+static uint32_t now_ms() {
+	time_t seconds;
+	uint16_t millis;
+	time_ms(&seconds, &millis);
+	return (uint32_t)seconds * 1000 + millis;
+}
+
+static uint16_t get16(const uint8_t *data) {
+	return data[0] | data[1] << 8;
+}
+
+static uint32_t get32(const uint8_t *data) {
+	return get16(data) | (uint32_t)get16(data + 2) << 16;
+}
+
+static uint32_t get_varint(const uint8_t **data) {
+	uint32_t value = 0;
+	for(int shift = 0; ; shift += 7) {
+		uint8_t byte = *(*data)++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if(!(byte & 0x80)) {
+			return value;
+		}
+	}
+}
+
+// The face may read the clock before the replay starts
+static void read_start() {
+	if(s_cursor) {
+		return;
+	}
+	
+	const uint8_t *header = s_event_trace;
+	if(sizeof(s_event_trace) < EVENT_TRACE_HEADER_SIZE || header[0] != 'E' || header[1] != 'T' ||
+			header[2] != EVENT_TRACE_FORMAT_VERSION || header[3] != EVENT_START) {
+		APP_LOG(APP_LOG_LEVEL_ERROR, "event_trace_data.h holds no usable trace");
+		s_cursor = s_event_trace + sizeof(s_event_trace);
+		return;
+	}
+	s_now = get32(header + 5);
+	s_cursor = header + EVENT_TRACE_HEADER_SIZE;
+}
+
+static void log_results() {
+	int events = 0;
+	for(int i = 0; i < EVENT_TYPE_COUNT; i++) {
+		events += s_stats[i].calls;
+	}
+	APP_LOG(APP_LOG_LEVEL_INFO, "replay done: events=%d ms=%lu", events,
+		(unsigned long)(now_ms() - s_replay_start));
+	
+	for(int i = EVENT_TICK; i < EVENT_TYPE_COUNT; i++) {
+		APP_LOG(APP_LOG_LEVEL_INFO, "replay %s: calls=%d total_ms=%lu max_ms=%lu", s_event_names[i],
+			s_stats[i].calls, (unsigned long)s_stats[i].total_ms, (unsigned long)s_stats[i].max_ms);
+	}
+	APP_LOG(APP_LOG_LEVEL_INFO, "replay redraws: set_text=%d mark_dirty=%d",
+		s_set_text_count, s_mark_dirty_count);
+}
+
+// Feed one event to the face, then wait for the next step
+static void replay_next(void *data) {
+	const uint8_t *end = s_event_trace + sizeof(s_event_trace);
+	if(s_cursor >= end) {
+		log_results();
+		return;
+	}
+	
+	EventType type = *s_cursor++;
+	s_now += get_varint(&s_cursor);
+	uint32_t start = now_ms();
+	
+	switch(type) {
+		case EVENT_START:
+			s_now = get32(s_cursor);
+			s_cursor += 4;
+			break;
+		case EVENT_TICK: {
+			TimeUnits units_changed = s_cursor[0];
+			struct tm tick_time = {
+				.tm_sec = s_cursor[1],
+				.tm_min = s_cursor[2],
+				.tm_hour = s_cursor[3],
+				.tm_mday = s_cursor[4],
+				.tm_mon = s_cursor[5],
+				.tm_year = s_cursor[6],
+				.tm_wday = s_cursor[7],
+				.tm_yday = get16(s_cursor + 8)
+			};
+			s_cursor += 10;
+			if(s_tick_handler) {
+				s_tick_handler(&tick_time, units_changed);
+			}
+			break;
+		}
+		case EVENT_BATTERY: {
+			BatteryChargeState state = {
+				.charge_percent = s_cursor[0],
+				.is_charging = s_cursor[1] & 1,
+				.is_plugged = (s_cursor[1] & 2) != 0
+			};
+			s_cursor += 2;
+			if(s_battery_handler) {
+				s_battery_handler(state);
+			}
+			break;
+		}
+		case EVENT_CONNECTION: {
+			bool connected = *s_cursor++;
+			if(s_connection_handler) {
+				s_connection_handler(connected);
+			}
+			break;
+		}
+		case EVENT_TAP: {
+			AccelAxisType axis = s_cursor[0];
+			int32_t direction = (int8_t)s_cursor[1];
+			s_cursor += 2;
+			if(s_tap_handler) {
+				s_tap_handler(axis, direction);
+			}
+			break;
+		}
+		case EVENT_INBOX: {
+			uint16_t length = get16(s_cursor);
+			DictionaryIterator iterator;
+			dict_read_begin_from_buffer(&iterator, s_cursor + 2, length);
+			s_cursor += 2 + length;
+			if(s_inbox_handler) {
+				s_inbox_handler(&iterator, NULL);
+			}
+			break;
+		}
+		default:
+			APP_LOG(APP_LOG_LEVEL_ERROR, "Unknown event %d, stopping the replay", type);
+			log_results();
+			return;
+	}
+	
+	if(type != EVENT_START) {
+		uint32_t elapsed = now_ms() - start;
+		EventStats *stats = &s_stats[type];
+		stats->calls++;
+		stats->total_ms += elapsed;
+		stats->max_ms = MAX(stats->max_ms, elapsed);
+	}
+	app_timer_register(EVENT_TRACE_STEP_MS, replay_next, NULL);
+}
+
+// The replay starts once the face has subscribed to something
+static void start_replay() {
+	if(s_replaying) {
+		return;
+	}
+	s_replaying = true;
+	read_start();
+	app_timer_register(EVENT_TRACE_START_DELAY_MS, replay_next, NULL);
+	s_replay_start = now_ms() + EVENT_TRACE_START_DELAY_MS;
+}
+
+void event_trace_tick_subscribe(TimeUnits units, TickHandler handler) {
+	s_tick_handler = handler;
+	start_replay();
+}
+
+void event_trace_battery_subscribe(BatteryStateHandler handler) {
+	s_battery_handler = handler;
+	start_replay();
+}
+
+void event_trace_connection_subscribe(ConnectionHandlers handlers) {
+	s_connection_handler = handlers.pebble_app_connection_handler;
+	start_replay();
+}
+
+void event_trace_tap_subscribe(AccelTapHandler handler) {
+	s_tap_handler = handler;
+	start_replay();
+}
+
+void event_trace_inbox_register(AppMessageInboxReceived handler) {
+	s_inbox_handler = handler;
+	start_replay();
+}
+
+void event_trace_count_set_text() {
+	s_set_text_count++;
+}
+
+void event_trace_count_mark_dirty() {
+	s_mark_dirty_count++;
+}
+
+time_t event_trace_time(time_t *tloc) {
+	read_start();
+	if(tloc) {
+		*tloc = s_now;
+	}
+	return s_now;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+#include <pebble.h>
+
+// Uncomment to log every event the face receives as hex lines, which
+// tools/event_trace.py collects from `pebble logs` into a trace file
+// #define EVENT_TRACE_RECORD
+
+// Uncomment to feed the trace in event_trace_data.h, written by
+// tools/event_trace.py, through the face instead of the real services and
+// log call counts, redraw requests and timings. App timers still run on
+// the real clock, only time() follows the trace.
+// #define EVENT_TRACE_REPLAY
+
+// Trace format, numbers little endian:
+// "ET", format version, then events, each a type byte, the seconds since
+// the event before as a varint, and a payload:
+//   START       time as uint32, always first
+//   TICK        units changed, then struct tm as sec, min, hour, mday,
+//               mon, year - 1900, wday and yday as uint16
+//   BATTERY     charge percent, bit 0 charging, bit 1 plugged
+//   CONNECTION  1 if the phone app is connected
+//   TAP         axis, direction as int8
+//   INBOX       length as uint16, then the dictionary as received
+#define EVENT_TRACE_FORMAT_VERSION 1
+
+typedef enum {
+	EVENT_START,
+	EVENT_TICK,
+	EVENT_BATTERY,
+	EVENT_CONNECTION,
+	EVENT_TAP,
+	EVENT_INBOX,
+	EVENT_TYPE_COUNT
+} EventType;
+
+#if defined(EVENT_TRACE_RECORD) || defined(EVENT_TRACE_REPLAY)
+
+#if defined(EVENT_TRACE_RECORD) && defined(EVENT_TRACE_REPLAY)
+#error "Record or replay an event trace, not both"
+#endif
+#ifdef BENCHMARK
+#error "The benchmark day and an event trace both drive the face, use one"
+#endif
+
+void event_trace_tick_subscribe(TimeUnits units, TickHandler handler);
+void event_trace_battery_subscribe(BatteryStateHandler handler);
+void event_trace_connection_subscribe(ConnectionHandlers handlers);
+void event_trace_tap_subscribe(AccelTapHandler handler);
+void event_trace_inbox_register(AppMessageInboxReceived handler);
+
+// The face subscribes through the trace, which records each event on its
+// way to the face's handler or replays the trace into the handlers
+#define tick_timer_service_subscribe(units, handler) event_trace_tick_subscribe(units, handler)
+#define battery_state_service_subscribe(handler) event_trace_battery_subscribe(handler)
+#define connection_service_subscribe(...) event_trace_connection_subscribe(__VA_ARGS__)
+#define accel_tap_service_subscribe(handler) event_trace_tap_subscribe(handler)
+#define app_message_register_inbox_received(handler) event_trace_inbox_register(handler)
+
+#endif
+
+#ifdef EVENT_TRACE_REPLAY
+
+void event_trace_count_set_text(void);
+void event_trace_count_mark_dirty(void);
+time_t event_trace_time(time_t *tloc);
+
+// Count every redraw request. The names are not expanded again inside
+// their own macro, so these still call the SDK functions.
+#define text_layer_set_text(layer, text) (event_trace_count_set_text(), text_layer_set_text(layer, text))
+#define layer_mark_dirty(layer) (event_trace_count_mark_dirty(), layer_mark_dirty(layer))
+
+// The face reads the clock of the trace
+#define time(tloc) event_trace_time(tloc)
+
+#endif
@@ -1,4 +1,10 @@
 #include <pebble.h>
+#include "background.h"
+#include "digit_anim.h"
+#include "event_trace.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
+#include "time_format.h"
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
@@ -9,27 +15,22 @@ static int s_battery_level;
 // Declare font globally
 static GFont s_time_font;
 
-// use a TextLayer element to add to the Window
-static TextLayer *s_time_layer;
-
 // layer for the battery bar
 static Layer *s_battery_layer;
 
-// Pointers for bitmap
-static BitmapLayer *s_background_layer;
-static GBitmap *s_background_bitmap;
+// text of the time, reformatted when the minute changes
+static TimeFormatter s_time_format;
 
 static void update_time() {
 	// Get a tm structure
 	time_t temp = time(NULL);
 	struct tm *tick_time = localtime(&temp);
 	
-	//Write the current hours and minutes into a buffer
-	static char s_buffer[8];
-	strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ? "%H:%M" : "%I:%M", tick_time);
-	
-	// Display this time on the TextLayer
-	text_layer_set_text(s_time_layer, s_buffer);
+	// Write the hours and minutes only when they changed
+	if(time_format_update(&s_time_format, tick_time) & TIME_FORMAT_TIME) {
+		// Roll in the digits that changed, each marks only its own cell dirty
+		digit_anim_set_text(s_time_format.time);
+	}
 }
 
 // start TickTimerService event service. struct tm contains the current time
@@ -65,74 +66,72 @@ static void battery_update_proc(Layer *layer, GContext *ctx) {
 
 // handler function
 static void main_window_load(Window *window) {
+	heap_trace_point(HEAP_LOAD_START);
+	
 	// Get information about the Window
 	Layer *window_layer = window_get_root_layer(window);
 	GRect bounds = layer_get_bounds(window_layer);
 	
-	// Create GBitmap - this needs to be before the TextLayer
-	s_background_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_BACKGROUND);
-	
-	// Create BitmapLayer to display the GBitmap
-	s_background_layer = bitmap_layer_create(bounds);
-	
-	// Set the bitmap onto the layer and add to the window
-	bitmap_layer_set_bitmap(s_background_layer, s_background_bitmap);
-	layer_add_child(window_layer, bitmap_layer_get_layer(s_background_layer));
-	
-	// Create the TextLayer with specific bounds
-	s_time_layer = text_layer_create(
-		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50));
+	// Add the background first so it is under the time
+	HEAP_TRACE_CALL("background", background_load(window, RESOURCE_ID_BACKGROUND_RLE));
 	
 	// Create battery meter Layer
-	s_battery_layer = layer_create(GRect(14, 54, 115, 2));
+	s_battery_layer = HEAP_TRACE_OBJECT("battery layer", layer_create(GRect(14, 54, 115, 2)));
 	layer_set_update_proc(s_battery_layer, battery_update_proc);
 	
 	// Add to Window
 	layer_add_child(window_get_root_layer(window), s_battery_layer);
 	
-	// Improve the layout to be more like a watchface
-	text_layer_set_background_color(s_time_layer, GColorClear);
-	text_layer_set_text_color(s_time_layer, GColorBlack);
-	// text_layer_set_text(s_time_layer, "00:00");  // Placeholder
-
   // Create GFont
-    s_time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_48));
-
-    // Apply to TextLayer
-    text_layer_set_font(s_time_layer, s_time_font);
+    s_time_font = HEAP_TRACE_OBJECT("time font",
+		fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_48)));
 	
-	// text_layer_set_font(s_time_layer, fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD));   //previous font
-	text_layer_set_text_alignment(s_time_layer, GTextAlignmentCenter);
+	// Add the time, a layer per digit so only the digits that change redraw
+	digit_anim_load(window_layer, GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50), s_time_font,
+		GColorBlack, background_mark_dirty);
+	digit_anim_set_text(s_time_format.time);
 	
-	// Add it as a child layer to the Window's root layer
-	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
 static void main_window_unload(Window *window) {
-	// Destroy TextLayer
-	text_layer_destroy(s_time_layer);
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
+	
+	// Destroy the time
+	digit_anim_unload();
 	
 	//Unload GFont
 	fonts_unload_custom_font(s_time_font);
 	
-	// Destroy GBitmap
-	gbitmap_destroy(s_background_bitmap);
-	
-	// Destroy BitmapLayer
-	bitmap_layer_destroy(s_background_layer);
+	// Destroy the background
+	background_unload();
 	
 	// Destroy the battery layer
 	layer_destroy(s_battery_layer);
+	
+	heap_trace_point(HEAP_UNLOAD_END);
+}
+
+// Something else may have drawn over the window while it was hidden
+static void main_window_appear(Window *window) {
+	background_invalidate();
 }
 
 static void init() {
+	// Read the 12/24 hour setting once
+	time_format_init(&s_time_format, '0');
+	
 	// Create main Window element and assign to pointer
 	s_main_window = window_create();
 	
 	// set handlers to manage the elements inside the Window
 	window_set_window_handlers(s_main_window, (WindowHandlers) {
 		.load = main_window_load,
+		.appear = main_window_appear,
 		.unload = main_window_unload
 	});
 	
@@ -0,0 +1,22 @@
+#pragma once
+#include <pebble.h>
+
+// Uncomment to draw the whole background only once. The frame buffer then
+// keeps it and each redraw only decodes the areas the layers above changed,
+// instead of the whole image every frame.
+// #define BACKGROUND_CACHE
+
+// Uncomment to log how many pixels each frame restores
+// #define BACKGROUND_TRACE
+
+// Add the background as the bottom layer of the window. The resource is a
+// raw run-length encoded image made by tools/rle_background.py, decoded
+// straight into the frame buffer so the image is never held in the heap.
+void background_load(Window *window, uint32_t resource_id);
+void background_unload(void);
+
+// Area that a layer above is about to change, restored on the next frame
+void background_mark_dirty(GRect rect);
+
+// Restore the whole background, for when something else drew over the window
+void background_invalidate(void);
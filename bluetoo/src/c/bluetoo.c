@@ -1,35 +1,45 @@
 #include <pebble.h>
+#include "background.h"
+#include "bt_debounce.h"
+#include "digit_anim.h"
+#include "event_trace.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
+#include "time_format.h"
+
+// below this charge, unless charging, a disconnect no longer vibrates
+#define POWER_SAVER_PERCENT 20
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
 
 // integer to store battery level percentage
 static int s_battery_level;
+static bool s_power_saving;
 
 // Declare font globally
 static GFont s_time_font;
 
-// use a TextLayer element to add to the Window
-static TextLayer *s_time_layer;
-
 // layer for the battery bar
 static Layer *s_battery_layer;
 
 // Pointers for bitmap
-static BitmapLayer *s_background_layer, *s_bt_icon_layer;
-static GBitmap *s_background_bitmap, *s_bt_icon_bitmap;
+static BitmapLayer *s_bt_icon_layer;
+static GBitmap *s_bt_icon_bitmap;
+
+// text of the time, reformatted when the minute changes
+static TimeFormatter s_time_format;
 
 static void update_time() {
 	// Get a tm structure
 	time_t temp = time(NULL);
 	struct tm *tick_time = localtime(&temp);
 	
-	//Write the current hours and minutes into a buffer
-	static char s_buffer[8];
-	strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ? "%H:%M" : "%I:%M", tick_time);
-	
-	// Display this time on the TextLayer
-	text_layer_set_text(s_time_layer, s_buffer);
+	// Write the hours and minutes only when they changed
+	if(time_format_update(&s_time_format, tick_time) & TIME_FORMAT_TIME) {
+		// Roll in the digits that changed, each marks only its own cell dirty
+		digit_anim_set_text(s_time_format.time);
+	}
 }
 
 // start TickTimerService event service. struct tm contains the current time
@@ -37,10 +47,20 @@ static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
 	update_time();
 }
 
+// Apply the power policy for the current battery state
+static void set_power_saving(BatteryChargeState state) {
+	bool saving = !state.is_charging && !state.is_plugged && state.charge_percent <= POWER_SAVER_PERCENT;
+	if(saving != s_power_saving) {
+		APP_LOG(APP_LOG_LEVEL_INFO, "Power saving %s at %d%%", saving ? "on" : "off", state.charge_percent);
+		s_power_saving = saving;
+	}
+}
+
 // callback to store the current charge percentage
 static void battery_callback(BatteryChargeState state) {
 	// Record the new battery level
 	s_battery_level = state.charge_percent;
+	set_power_saving(state);
 	
 	// Update meter
 	layer_mark_dirty(s_battery_layer);
@@ -63,104 +83,118 @@ static void battery_update_proc(Layer *layer, GContext *ctx) {
 	
 }
 
+// The debounced connection, see bt_debounce.h
+static void show_bluetooth(bool disconnected, bool alert) {
+	// Show icon if disconnected
+	background_mark_dirty(layer_get_frame(bitmap_layer_get_layer(s_bt_icon_layer)));
+	layer_set_hidden(bitmap_layer_get_layer(s_bt_icon_layer), !disconnected);
+	
+	if(alert && !s_power_saving) {
+		// Issue a vibrating alert
+		vibes_double_pulse();
+	}
+}
+
 // Set up Bluetooth service subscription
 static void bluetooth_callback(bool connected) {
-  // Show icon if disconnected
-  layer_set_hidden(bitmap_layer_get_layer(s_bt_icon_layer), connected);
-
-  if(!connected) {
-    // Issue a vibrating alert
-    vibes_double_pulse();
-  }
+	bt_debounce_update(connected);
 }
 
 // handler function
 static void main_window_load(Window *window) {
+	heap_trace_point(HEAP_LOAD_START);
+	
 	// Get information about the Window
 	Layer *window_layer = window_get_root_layer(window);
 	GRect bounds = layer_get_bounds(window_layer);
 	
-	// Create GBitmap - this needs to appear before (under) the TextLayer
-	s_background_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_BACKGROUND);
+	// Add the background first so it is under the time and the icon
+	HEAP_TRACE_CALL("background", background_load(window, RESOURCE_ID_BACKGROUND_RLE));
 	
 	// Create the Bluetooth icon GBitmap
-	s_bt_icon_bitmap = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_BT_ICON);
+	s_bt_icon_bitmap = HEAP_TRACE_OBJECT("bluetooth icon", gbitmap_create_with_resource(RESOURCE_ID_IMAGE_BT_ICON));
 
 	// Create the BitmapLayer to display the GBitmap for bluetooth icon
-	s_bt_icon_layer = bitmap_layer_create(GRect(59, 12, 30, 30));
+	s_bt_icon_layer = HEAP_TRACE_OBJECT("bluetooth layer", bitmap_layer_create(GRect(59, 12, 30, 30)));
 	bitmap_layer_set_bitmap(s_bt_icon_layer, s_bt_icon_bitmap);
 	layer_add_child(window_get_root_layer(window), bitmap_layer_get_layer(s_bt_icon_layer));
 	
-	// Create BitmapLayer to display the GBitmap for the background graphic
-	s_background_layer = bitmap_layer_create(bounds);
-	
-	// Set the bitmap onto the layer and add to the window
-	bitmap_layer_set_bitmap(s_background_layer, s_background_bitmap);
-	layer_add_child(window_layer, bitmap_layer_get_layer(s_background_layer));
-	
-	// Create the TextLayer with specific bounds
-	s_time_layer = text_layer_create(
-		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50));
-	
 	// Create battery meter Layer
-	s_battery_layer = layer_create(GRect(14, 54, 115, 2));
+	s_battery_layer = HEAP_TRACE_OBJECT("battery layer", layer_create(GRect(14, 54, 115, 2)));
 	layer_set_update_proc(s_battery_layer, battery_update_proc);
 	
-	// Improve the layout to be more like a watchface
-	text_layer_set_background_color(s_time_layer, GColorClear);
-	text_layer_set_text_color(s_time_layer, GColorBlack);
-
   // Create GFont
-    s_time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_48));
+    s_time_font = HEAP_TRACE_OBJECT("time font",
+		fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_PERFECT_DOS_48)));
 
-    // Apply the font to TextLayer
-    text_layer_set_font(s_time_layer, s_time_font);
-	text_layer_set_text_alignment(s_time_layer, GTextAlignmentCenter);
-	
-	// Add it as a child layer to the Window's root layer
-	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
+	// Add the time, a layer per digit so only the digits that change redraw
+	digit_anim_load(window_layer, GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50), s_time_font,
+		GColorBlack, background_mark_dirty);
+	digit_anim_set_text(s_time_format.time);
 	
 	// Add to Window
 	layer_add_child(window_get_root_layer(window), s_battery_layer);
 	
 	// Show the correct state of the BT connection from the start
+	bt_debounce_refresh();
 	bluetooth_callback(connection_service_peek_pebble_app_connection());
+	
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
+// Destroy everything in the reverse order of main_window_load, so nothing
+// is freed while a layer still uses it
 static void main_window_unload(Window *window) {
-	// Destroy TextLayer
-	text_layer_destroy(s_time_layer);
-	
-	//Unload GFont
-	fonts_unload_custom_font(s_time_font);
-	
-	// Destroy GBitmap
-	gbitmap_destroy(s_background_bitmap);
-	
-	// Destroy BitmapLayer
-	bitmap_layer_destroy(s_background_layer);
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
 	
 	// Destroy the battery layer
 	layer_destroy(s_battery_layer);
 	
+	// Destroy the time
+	digit_anim_unload();
+	
+	//Unload GFont
+	fonts_unload_custom_font(s_time_font);
+	
 	// Destroy bluetooth icon layer
-	gbitmap_destroy(s_bt_icon_bitmap);
 	bitmap_layer_destroy(s_bt_icon_layer);
+	gbitmap_destroy(s_bt_icon_bitmap);
+	
+	// Destroy the background
+	background_unload();
+	
+	heap_trace_point(HEAP_UNLOAD_END);
+}
+
+// Something else may have drawn over the window while it was hidden
+static void main_window_appear(Window *window) {
+	background_invalidate();
 }
 
 static void init() {
+	// Read the 12/24 hour setting once
+	time_format_init(&s_time_format, '0');
+	bt_debounce_init(show_bluetooth);
+	
 	// Create main Window element and assign to pointer
 	s_main_window = window_create();
 	
 	// set handlers to manage the elements inside the Window
 	window_set_window_handlers(s_main_window, (WindowHandlers) {
 		.load = main_window_load,
+		.appear = main_window_appear,
 		.unload = main_window_unload
 	});
 	
 	window_set_background_color(s_main_window, GColorBlack);
 	
+	// Start in the right power mode, so a disconnect at launch respects it
+	set_power_saving(battery_state_service_peek());
+	
 	// Show the Window on the watch, with animated=true
 	window_stack_push(s_main_window, true);
 	
@@ -186,6 +220,8 @@ static void deinit() {
 	// every create function should be paired with destroy
 	// Destroy Window
 	window_destroy(s_main_window);
+	
+	bt_debounce_deinit();
 }
 
 int main(void) {
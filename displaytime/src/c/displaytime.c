@@ -1,4 +1,8 @@
 #include <pebble.h>
+#include "event_trace.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
+#include "time_format.h"
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
@@ -6,17 +10,19 @@ static Window *s_main_window;
 // use a TextLayer element to add to the Window
 static TextLayer *s_time_layer;
 
+// text of the time, reformatted when the minute changes
+static TimeFormatter s_time_format;
+
 static void update_time() {
 	// Get a tm structure
 	time_t temp = time(NULL);
 	struct tm *tick_time = localtime(&temp);
 	
-	//Write the current hours and minutes into a buffer
-	static char s_buffer[8];
-	strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ? "%H:%M" : "%I:%M", tick_time);
-	
-	// Display this time on the TextLayer
-	text_layer_set_text(s_time_layer, s_buffer);
+	// Write the hours and minutes only when they changed
+	if(time_format_update(&s_time_format, tick_time) & TIME_FORMAT_TIME) {
+		// Display this time on the TextLayer
+		text_layer_set_text(s_time_layer, s_time_format.time);
+	}
 }
 
 // start TickTimerService event service. struct tm contains the current time
@@ -26,13 +32,15 @@ static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
 
 // handler function
 static void main_window_load(Window *window) {
+	heap_trace_point(HEAP_LOAD_START);
+	
 	// Get information about the Window
 	Layer *window_layer = window_get_root_layer(window);
 	GRect bounds = layer_get_bounds(window_layer);
 	
 	// Create the TextLayer with specific bounds
-	s_time_layer = text_layer_create(
-		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50));
+	s_time_layer = HEAP_TRACE_OBJECT("time layer", text_layer_create(
+		GRect(0, PBL_IF_ROUND_ELSE(58, 52), bounds.size.w, 50)));
 	
 	// Improve the layout to be more like a watchface
 	// I swapped the colors from the tutorial, but the background is only behind the text
@@ -44,15 +52,27 @@ static void main_window_load(Window *window) {
 	
 	// Add it as a child layer to the Window's root layer
 	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
+	
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
 static void main_window_unload(Window *window) {
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
+	
 	// Destroy TextLayer
 	text_layer_destroy(s_time_layer);
+	
+	heap_trace_point(HEAP_UNLOAD_END);
 }
 
 static void init() {
+	// Read the 12/24 hour setting once
+	time_format_init(&s_time_format, '0');
+	
 	// Create main Window element and assign to pointer
 	s_main_window = window_create();
 	
@@ -0,0 +1,31 @@
+#pragma once
+#include <pebble.h>
+
+// Uncomment to read back every frame the window draws and log its hash,
+// how many pixels changed since the frame before and where, and each
+// minute how many pixels its frames changed in total
+// #define FRAME_CAPTURE
+
+// Uncomment as well to log the pixels of every frame, which
+// tools/frame_capture.py turns into PNG files and compares with golden frames
+// #define FRAME_CAPTURE_DUMP
+
+#ifdef FRAME_CAPTURE
+
+// Add the capture layer on top of everything the window draws, last in
+// window load, and remove it first in window unload
+void frame_capture_load(Layer *window_layer);
+void frame_capture_unload(void);
+
+// Group frames into minutes by this clock instead of time(), for a bench
+// that runs the face on a simulated one
+typedef time_t (*FrameCaptureClock)(time_t *tloc);
+void frame_capture_set_clock(FrameCaptureClock clock);
+
+#else
+
+#define frame_capture_load(window_layer)
+#define frame_capture_unload()
+#define frame_capture_set_clock(clock)
+
+#endif
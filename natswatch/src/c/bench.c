@@ -0,0 +1,442 @@
+#include "bench.h"
+#include "digit_anim.h"
+#include "frame_capture.h"
+#include "time_format.h"
+
+#ifdef BENCHMARK
+
+// the bench itself runs on the real clock
+#undef time
+
+// a simulated day is 24 hours of minute ticks
+#define BENCH_MINUTES (24 * MINUTES_PER_HOUR)
+
+// leave time between steps so the window renders after every tick
+#define BENCH_STEP_MS 20
+
+// The rest of the simulated day: the wrist flicks every BENCH_TAP_MINUTES
+// while the watch is worn, the battery drains by a percent an hour and the
+// phone goes out of range during s_disconnects. The phone answers every
+// weather request straight away.
+#define BENCH_WEAR_START_HOUR 7
+#define BENCH_WEAR_END_HOUR 23
+#define BENCH_TAP_MINUTES 15
+
+// A workout at this minute of the day double flicks into seconds mode, which
+// runs until its timeout. Its ticks, drawing and pixels are totalled apart.
+#define BENCH_WORKOUT_START (17 * MINUTES_PER_HOUR + 5)
+
+// Energy per operation in nAh, rough figures to compare builds with rather
+// than a battery life prediction. Replace them with measurements.
+#define ENERGY_IDLE_PER_HOUR 150000  // screen on, CPU asleep
+#define ENERGY_WAKEUP 3  // dispatching one event to the face
+#define ENERGY_CPU_PER_MS 3  // running face code
+#define ENERGY_RADIO_PER_MESSAGE 300  // one AppMessage either way
+#define ENERGY_VIBE_PER_MS 22  // the vibe motor
+#define ENERGY_DISPLAY_PER_MPIXEL 60  // pushing redrawn pixels to the screen
+
+typedef struct {
+	uint32_t calls;
+	uint32_t total_ms;
+	uint32_t max_ms;
+	uint32_t start_ms;
+} BenchTiming;
+
+static const char *s_callback_names[BENCH_CALLBACK_COUNT] = {
+	"update_time",
+	"tick_handler",
+	"battery_update_proc",
+	"inbox_received_callback",
+	"frame",
+	"draw_time"
+};
+
+static BenchTiming s_timings[BENCH_CALLBACK_COUNT];
+static uint32_t s_set_text_count;
+static uint32_t s_mark_dirty_count;
+static uint32_t s_dirty_pixels;
+static uint32_t s_outbox_sends;
+static uint32_t s_vibe_ms;
+static uint32_t s_wakeups;
+static uint32_t s_inbox_messages;
+
+// seconds mode, what the second ticks and the frames after them cost
+static uint32_t s_second_ticks;
+static uint32_t s_second_cpu_ms;
+static uint32_t s_second_pixels;
+static bool s_second_step;  // the last step was a second tick
+static uint32_t s_step_cpu_ms;  // face cpu time when that step started
+static uint32_t s_step_pixels;
+
+static BenchHandlers s_handlers;
+static int s_minute;
+static int s_second;  // within s_minute, only while the face ticks every second
+static size_t s_heap_start;
+static size_t s_heap_peak;
+
+// simulated clock
+static bool s_running;
+static time_t s_day_start;
+static TimeUnits s_tick_units = MINUTE_UNIT;
+static bool s_reply_due;  // the face asked for weather this step
+
+// minutes of the day the phone is out of range, start inclusive
+static const struct {
+	int start;
+	int end;
+} s_disconnects[] = {
+	{ 12 * MINUTES_PER_HOUR, 12 * MINUTES_PER_HOUR + 10 },
+	{ 18 * MINUTES_PER_HOUR + 30, 19 * MINUTES_PER_HOUR }
+};
+
+static uint8_t s_weather_buffer[64];
+
+// milliseconds since the epoch, truncated to 32 bits. Only differences are used.
+static uint32_t now_ms() {
+	time_t seconds;
+	uint16_t millis;
+	time_ms(&seconds, &millis);
+	return (uint32_t)seconds * 1000 + millis;
+}
+
+void bench_begin(BenchCallback callback) {
+	s_timings[callback].start_ms = now_ms();
+}
+
+// The clock only has millisecond resolution, but the start of each call
+// falls at a random point inside a millisecond, so the summed differences
+// still average out to the real cost over a day of calls
+void bench_end(BenchCallback callback) {
+	BenchTiming *timing = &s_timings[callback];
+	uint32_t elapsed = now_ms() - timing->start_ms;
+	
+	timing->calls++;
+	timing->total_ms += elapsed;
+	if(elapsed > timing->max_ms) {
+		timing->max_ms = elapsed;
+	}
+}
+
+void bench_count_set_text() {
+	s_set_text_count++;
+}
+
+void bench_count_mark_dirty() {
+	s_mark_dirty_count++;
+}
+
+// area of the face that actually changed
+void bench_count_dirty_pixels(int pixels) {
+	s_dirty_pixels += pixels;
+}
+
+void bench_count_outbox_send() {
+	s_outbox_sends++;
+	s_reply_due = true;
+}
+
+void bench_count_vibe(int duration_ms) {
+	s_vibe_ms += duration_ms;
+}
+
+void bench_tick_subscribe(TimeUnits units) {
+	s_tick_units = units;
+}
+
+time_t bench_time(time_t *tloc) {
+	if(!s_running) {
+		return time(tloc);
+	}
+	
+	time_t now = s_day_start + s_minute * SECONDS_PER_MINUTE + s_second;
+	if(tloc) {
+		*tloc = now;
+	}
+	return now;
+}
+
+static uint32_t face_cpu_ms() {
+	return s_timings[BENCH_TICK_HANDLER].total_ms +
+		s_timings[BENCH_INBOX_RECEIVED].total_ms + s_timings[BENCH_FRAME].total_ms;
+}
+
+// Charge the last step, with the frame it caused, to seconds mode if it
+// was a second tick
+static void start_step(bool second) {
+	uint32_t cpu_ms = face_cpu_ms();
+	if(s_second_step) {
+		s_second_cpu_ms += cpu_ms - s_step_cpu_ms;
+		s_second_pixels += s_dirty_pixels - s_step_pixels;
+	}
+	s_second_step = second;
+	s_step_cpu_ms = cpu_ms;
+	s_step_pixels = s_dirty_pixels;
+}
+
+static void log_energy_part(const char *name, uint64_t nah) {
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench energy %s: %lu nAh", name, (unsigned long)nah);
+}
+
+// Apply the energy table to what the day counted
+static void log_energy() {
+	uint64_t cpu_ms = face_cpu_ms();
+	uint32_t messages = s_outbox_sends + s_inbox_messages;
+	
+	uint64_t idle = (uint64_t)ENERGY_IDLE_PER_HOUR * BENCH_MINUTES / MINUTES_PER_HOUR;
+	uint64_t wakeups = (uint64_t)ENERGY_WAKEUP * s_wakeups;
+	uint64_t cpu = ENERGY_CPU_PER_MS * cpu_ms;
+	uint64_t radio = (uint64_t)ENERGY_RADIO_PER_MESSAGE * messages;
+	uint64_t vibes = (uint64_t)ENERGY_VIBE_PER_MS * s_vibe_ms;
+	uint64_t display = (uint64_t)ENERGY_DISPLAY_PER_MPIXEL * s_dirty_pixels / 1000000;
+	uint64_t total = idle + wakeups + cpu + radio + vibes + display;
+	
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench events: wakeups=%lu cpu=%lums messages=%lu vibe=%lums pixels=%lu",
+		(unsigned long)s_wakeups, (unsigned long)cpu_ms, (unsigned long)messages,
+		(unsigned long)s_vibe_ms, (unsigned long)s_dirty_pixels);
+	log_energy_part("idle", idle);
+	log_energy_part("wakeups", wakeups);
+	log_energy_part("cpu", cpu);
+	log_energy_part("radio", radio);
+	log_energy_part("vibes", vibes);
+	log_energy_part("display", display);
+	
+	// The day is simulated in full, so the total is the daily figure
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench energy: %lu.%03lu mAh/day",
+		(unsigned long)(total / 1000000), (unsigned long)(total / 1000 % 1000));
+	
+	// Already part of the day, this is what seconds mode added per hour
+	uint64_t seconds = (uint64_t)ENERGY_WAKEUP * s_second_ticks + ENERGY_CPU_PER_MS * s_second_cpu_ms +
+		(uint64_t)ENERGY_DISPLAY_PER_MPIXEL * s_second_pixels / 1000000;
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench seconds: ticks=%lu cpu=%lums pixels=%lu energy=%lu nAh/hour",
+		(unsigned long)s_second_ticks, (unsigned long)s_second_cpu_ms, (unsigned long)s_second_pixels,
+		(unsigned long)(s_second_ticks ? seconds * SECONDS_PER_HOUR / s_second_ticks : 0));
+}
+
+static bool phone_connected(int minute) {
+	for(size_t i = 0; i < ARRAY_LENGTH(s_disconnects); i++) {
+		if(minute >= s_disconnects[i].start && minute < s_disconnects[i].end) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void log_results() {
+	for(int i = 0; i < BENCH_CALLBACK_COUNT; i++) {
+		BenchTiming *timing = &s_timings[i];
+		uint32_t average_ns = timing->calls ?
+			(uint32_t)(((uint64_t)timing->total_ms * 1000000) / timing->calls) : 0;
+		
+		APP_LOG(APP_LOG_LEVEL_INFO, "bench %s: calls=%lu avg=%luns max=%lums",
+			s_callback_names[i], (unsigned long)timing->calls,
+			(unsigned long)average_ns, (unsigned long)timing->max_ms);
+	}
+	
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench redraws: text_layer_set_text=%lu layer_mark_dirty=%lu dirty_pixels=%lu",
+		(unsigned long)s_set_text_count, (unsigned long)s_mark_dirty_count, (unsigned long)s_dirty_pixels);
+	
+	size_t heap_end = heap_bytes_used();
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench heap: start=%u end=%u peak=%u growth=%d",
+		(unsigned)s_heap_start, (unsigned)heap_end, (unsigned)s_heap_peak,
+		(int)heap_end - (int)s_heap_start);
+	
+	digit_anim_log();
+	log_energy();
+}
+
+static void step(void *data);
+
+// Between minutes a face in seconds mode gets a tick every second
+static void second_step(void *data) {
+	start_step(true);
+	
+	time_t now = bench_time(NULL);
+	struct tm tick_time = *localtime(&now);
+	if(s_tick_units & SECOND_UNIT) {
+		s_wakeups++;
+		s_second_ticks++;
+		s_handlers.tick(&tick_time, SECOND_UNIT);
+	}
+	
+	if(s_second < SECONDS_PER_MINUTE - 1 && (s_tick_units & SECOND_UNIT)) {
+		s_second++;
+		app_timer_register(BENCH_STEP_MS, second_step, NULL);
+		return;
+	}
+	s_second = 0;
+	s_minute++;
+	app_timer_register(BENCH_STEP_MS, step, NULL);
+}
+
+// Feed one simulated minute through the face, then wait for the next step
+static void step(void *data) {
+	// Let the roll of the last minute finish, so each transition is whole
+	if(digit_anim_running()) {
+		app_timer_register(BENCH_STEP_MS, step, NULL);
+		return;
+	}
+	start_step(false);
+	if(s_minute >= BENCH_MINUTES) {
+		s_running = false;
+		log_results();
+		return;
+	}
+	
+	// Build the tick time for this minute of the day
+	time_t now = bench_time(NULL);
+	struct tm tick_time = *localtime(&now);
+	
+	TimeUnits units_changed = MINUTE_UNIT;
+	if(tick_time.tm_min == 0) {
+		units_changed |= HOUR_UNIT;
+	}
+	if(s_minute == 0) {
+		units_changed |= DAY_UNIT;
+	}
+	if(s_tick_units & SECOND_UNIT) {
+		units_changed |= SECOND_UNIT;
+	}
+	
+	// Only the ticks the face subscribed to wake it
+	if(units_changed & s_tick_units) {
+		s_wakeups++;
+		s_handlers.tick(&tick_time, units_changed);
+	}
+	
+	// Drain the battery by one percent an hour
+	if(tick_time.tm_min == 0) {
+		s_wakeups++;
+		s_handlers.battery((BatteryChargeState) {
+			.charge_percent = 100 - tick_time.tm_hour,
+			.is_charging = false,
+			.is_plugged = false
+		});
+	}
+	
+	bool connected = phone_connected(s_minute);
+	if(s_minute > 0 && connected != phone_connected(s_minute - 1)) {
+		s_wakeups++;
+		s_handlers.connection(connected);
+	}
+	
+	if(tick_time.tm_hour >= BENCH_WEAR_START_HOUR && tick_time.tm_hour < BENCH_WEAR_END_HOUR &&
+			tick_time.tm_min % BENCH_TAP_MINUTES == 0) {
+		s_wakeups++;
+		s_handlers.tap(ACCEL_AXIS_Y, 1);
+	}
+	if(s_minute == BENCH_WORKOUT_START) {
+		s_wakeups += 2;
+		s_handlers.tap(ACCEL_AXIS_Y, 1);
+		s_handlers.tap(ACCEL_AXIS_Y, 1);
+	}
+	
+	// Answer the weather request the face sent
+	if(s_reply_due && connected) {
+		DictionaryIterator iter;
+		dict_write_begin(&iter, s_weather_buffer, sizeof(s_weather_buffer));
+		s_handlers.write_weather(&iter, s_minute);
+		uint32_t size = dict_write_end(&iter);
+		
+		dict_read_begin_from_buffer(&iter, s_weather_buffer, size);
+		s_wakeups++;
+		s_inbox_messages++;
+		s_handlers.inbox(&iter, NULL);
+	}
+	s_reply_due = false;
+	
+	size_t heap_used = heap_bytes_used();
+	if(heap_used > s_heap_peak) {
+		s_heap_peak = heap_used;
+	}
+	
+	if(s_tick_units & SECOND_UNIT) {
+		s_second = 1;
+		app_timer_register(BENCH_STEP_MS, second_step, NULL);
+		return;
+	}
+	s_minute++;
+	app_timer_register(BENCH_STEP_MS, step, NULL);
+}
+
+// Format a day of minutes with strftime as update_time used to, then with
+// time_format, which only rewrites what changed
+static void bench_formatting(time_t day_start) {
+	char text[16];
+	TimeFormatter formatter;
+	time_format_init(&formatter, ' ');
+	
+	uint32_t start = now_ms();
+	for(int minute = 0; minute < BENCH_MINUTES; minute++) {
+		time_t now = day_start + minute * SECONDS_PER_MINUTE;
+		struct tm *tick_time = localtime(&now);
+		if(minute == 0) {
+			strftime(text, sizeof(text), "%A", tick_time);
+			strftime(text, sizeof(text), "%B %e", tick_time);
+		}
+		strftime(text, sizeof(text), clock_is_24h_style() ? "%H:%M" : "%l:%M", tick_time);
+	}
+	uint32_t strftime_ms = now_ms() - start;
+	
+	start = now_ms();
+	int mismatches = 0;
+	for(int minute = 0; minute < BENCH_MINUTES; minute++) {
+		time_t now = day_start + minute * SECONDS_PER_MINUTE;
+		struct tm *tick_time = localtime(&now);
+		time_format_update(&formatter, tick_time);
+		
+#if TIME_FORMAT_LANGUAGE == TIME_FORMAT_EN
+		// Check the output against strftime outside the timing
+		uint32_t check_start = now_ms();
+		strftime(text, sizeof(text), "%A", tick_time);
+		mismatches += strcmp(text, formatter.day) != 0;
+		strftime(text, sizeof(text), "%B %e", tick_time);
+		mismatches += strcmp(text, formatter.date) != 0;
+		strftime(text, sizeof(text), clock_is_24h_style() ? "%H:%M" : "%l:%M", tick_time);
+		mismatches += strcmp(text, formatter.time) != 0;
+		start += now_ms() - check_start;
+#endif
+	}
+	uint32_t time_format_ms = now_ms() - start;
+	
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench format: strftime=%lums time_format=%lums for %d minutes, %d mismatches",
+		(unsigned long)strftime_ms, (unsigned long)time_format_ms, BENCH_MINUTES, mismatches);
+}
+
+void bench_run_day(BenchHandlers handlers) {
+	s_handlers = handlers;
+	s_minute = 0;
+	s_second = 0;
+	
+	// Only count what happens during the simulated day
+	memset(s_timings, 0, sizeof(s_timings));
+	s_set_text_count = 0;
+	s_mark_dirty_count = 0;
+	s_dirty_pixels = 0;
+	s_outbox_sends = 0;
+	s_vibe_ms = 0;
+	s_wakeups = 0;
+	s_inbox_messages = 0;
+	s_second_ticks = 0;
+	s_second_cpu_ms = 0;
+	s_second_pixels = 0;
+	s_second_step = false;
+	s_reply_due = false;
+	s_heap_start = heap_bytes_used();
+	s_heap_peak = s_heap_start;
+	
+	// The day starts at the next midnight, after anything the face did at launch
+	time_t now = time(NULL);
+	struct tm midnight = *localtime(&now);
+	midnight.tm_hour = 0;
+	midnight.tm_min = 0;
+	midnight.tm_sec = 0;
+	s_day_start = mktime(&midnight) + SECONDS_PER_DAY;
+	bench_formatting(s_day_start);
+	s_running = true;
+	frame_capture_set_clock(bench_time);
+	
+	APP_LOG(APP_LOG_LEVEL_INFO, "bench: simulating %d minute ticks", BENCH_MINUTES);
+	app_timer_register(BENCH_STEP_MS, step, NULL);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+#include <pebble.h>
+
+// Uncomment to replay a simulated day of minute ticks after startup and log
+// per-callback timings, redraw requests, heap growth and an estimate of the
+// energy the face used, see the energy table in bench.c. To run other days,
+// recorded or written as text, replay them on the host with tools/host.
+// #define BENCHMARK
+
+// callbacks that get timed individually
+typedef enum {
+	BENCH_UPDATE_TIME,
+	BENCH_TICK_HANDLER,
+	BENCH_BATTERY_UPDATE_PROC,
+	BENCH_INBOX_RECEIVED,
+	BENCH_FRAME,  // a whole render pass of the window
+	BENCH_DRAW_TIME,  // drawing just the time, inside a frame
+	BENCH_CALLBACK_COUNT
+} BenchCallback;
+
+// the face callbacks the simulated day is driven through
+typedef struct {
+	TickHandler tick;
+	BatteryStateHandler battery;
+	AppMessageInboxReceived inbox;
+	AccelTapHandler tap;
+	ConnectionHandler connection;
+	// writes a sample weather reply for the given minute of the day
+	void (*write_weather)(DictionaryIterator *iter, int minute);
+} BenchHandlers;
+
+#ifdef BENCHMARK
+
+void bench_begin(BenchCallback callback);
+void bench_end(BenchCallback callback);
+void bench_count_set_text(void);
+void bench_count_mark_dirty(void);
+void bench_count_dirty_pixels(int pixels);
+void bench_count_outbox_send(void);
+void bench_count_vibe(int duration_ms);
+void bench_tick_subscribe(TimeUnits units);
+time_t bench_time(time_t *tloc);
+void bench_run_day(BenchHandlers handlers);
+
+// Count every redraw request the face makes. The names are not expanded
+// again inside their own macro, so these still call the SDK functions.
+#define text_layer_set_text(layer, text) (bench_count_set_text(), text_layer_set_text(layer, text))
+#define layer_mark_dirty(layer) (bench_count_mark_dirty(), layer_mark_dirty(layer))
+
+// how long vibes_double_pulse() runs the motor
+#define BENCH_DOUBLE_PULSE_MS 200
+
+// Count what costs energy, and follow the tick subscription so sleep mode
+// only gets the ticks it asked for
+#define app_message_outbox_send() (bench_count_outbox_send(), app_message_outbox_send())
+#define vibes_double_pulse() (bench_count_vibe(BENCH_DOUBLE_PULSE_MS), vibes_double_pulse())
+#define tick_timer_service_subscribe(units, handler) \
+	(bench_tick_subscribe(units), tick_timer_service_subscribe(units, handler))
+
+// The face reads the simulated clock while the day runs, so weather
+// refreshes, backoff and sleep mode follow it
+#define time(tloc) bench_time(tloc)
+
+#else
+
+#define bench_begin(callback)
+#define bench_end(callback)
+#define bench_count_dirty_pixels(pixels) ((void)(pixels))
+
+#endif
@@ -0,0 +1,79 @@
+#include "bt_debounce.h"
+
+typedef enum {
+	BT_CONNECTED,
+	BT_LOST,  // gone, waiting out BT_LOST_DELAY
+	BT_DISCONNECTED,  // gone and alerted
+	BT_RESTORED  // back, waiting out BT_SETTLE_DELAY
+} BluetoothState;
+
+static BtDebounceHandler s_handler;
+static BluetoothState s_state = BT_CONNECTED;
+static AppTimer *s_timer;
+
+static void set_state(BluetoothState state, bool alert) {
+	s_state = state;
+	s_handler(state == BT_DISCONNECTED, alert);
+}
+
+// The link held steady through the delay
+static void timer_callback(void *data) {
+	s_timer = NULL;
+	
+	if(s_state == BT_RESTORED) {
+		set_state(BT_CONNECTED, false);
+		return;
+	}
+	set_state(BT_DISCONNECTED, true);
+}
+
+static void start_timer(uint32_t delay_ms) {
+	if(s_timer) {
+		app_timer_cancel(s_timer);
+	}
+	s_timer = delay_ms ? app_timer_register(delay_ms, timer_callback, NULL) : NULL;
+}
+
+void bt_debounce_update(bool connected) {
+	switch(s_state) {
+		case BT_CONNECTED:
+			if(!connected) {
+				set_state(BT_LOST, false);
+				start_timer(BT_LOST_DELAY);
+			}
+			break;
+		case BT_LOST:
+			// Back before anyone noticed
+			if(connected) {
+				set_state(BT_CONNECTED, false);
+				start_timer(0);
+			}
+			break;
+		case BT_DISCONNECTED:
+			if(connected) {
+				set_state(BT_RESTORED, false);
+				start_timer(BT_SETTLE_DELAY);
+			}
+			break;
+		case BT_RESTORED:
+			// Still flapping, show the icon again without another alert
+			if(!connected) {
+				set_state(BT_DISCONNECTED, false);
+				start_timer(0);
+			}
+			break;
+	}
+}
+
+void bt_debounce_refresh() {
+	s_handler(s_state == BT_DISCONNECTED, false);
+}
+
+void bt_debounce_init(BtDebounceHandler handler) {
+	s_handler = handler;
+	s_state = BT_CONNECTED;
+}
+
+void bt_debounce_deinit() {
+	start_timer(0);
+}
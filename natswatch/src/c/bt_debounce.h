@@ -0,0 +1,23 @@
+#pragma once
+#include <pebble.h>
+
+// Debounce the phone connection for the disconnect icon and alert. A
+// disconnect only shows and alerts once the phone has been gone for
+// BT_LOST_DELAY, and after it comes back the link has to stay up for
+// BT_SETTLE_DELAY before the next disconnect alerts again. A flapping
+// link alerts once.
+#define BT_LOST_DELAY 10000
+#define BT_SETTLE_DELAY 60000
+
+// Called to show or hide the disconnect icon, with alert set once per
+// disconnect for the face to vibrate
+typedef void (*BtDebounceHandler)(bool disconnected, bool alert);
+
+void bt_debounce_init(BtDebounceHandler handler);
+void bt_debounce_deinit(void);
+
+// Call with every connection change, and with the connection at window load
+void bt_debounce_update(bool connected);
+
+// Show the current state again, for a window that was just loaded
+void bt_debounce_refresh(void);
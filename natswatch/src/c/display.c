@@ -0,0 +1,640 @@
+#include "display.h"
+#include "bench.h"
+#include "digit_anim.h"
+#include "event_trace.h"
+#include "heap_trace.h"
+#include "profile.h"
+#include "telemetry.h"
+
+#if defined(DIGIT_ATLAS) && !defined(SINGLE_LAYER_RENDER)
+#error "DIGIT_ATLAS draws from the single layer, define SINGLE_LAYER_RENDER too"
+#endif
+
+// longest text any field shows, including the terminator
+#define DISPLAY_TEXT_SIZE 16
+
+static GFont s_time_font;
+
+// layout of each field, set up in display_load
+static GRect s_frames[FIELD_COUNT];
+static GFont s_fonts[FIELD_COUNT];
+static GTextAlignment s_alignments[FIELD_COUNT];
+static GRect s_bt_frame;
+static GRect s_seconds_frame;
+static GRect s_battery_frame;
+static GRect s_forecast_frame;
+
+static char s_text[FIELD_COUNT][DISPLAY_TEXT_SIZE];
+static bool s_hidden[FIELD_COUNT];  // hidden fields keep their background but draw no text
+
+// integer to store battery level percentage
+static int s_battery_level = -1;
+static bool s_bt_connected = true;
+
+// seconds in seconds mode, -1 while they are hidden
+static int s_seconds = -1;
+static char s_seconds_text[3];
+
+static DisplayForecastColumn s_forecast[DISPLAY_FORECAST_COLUMNS];
+static int s_forecast_count;  // 0 while the strip is hidden
+
+#ifdef SINGLE_LAYER_RENDER
+
+// one layer draws everything
+static Layer *s_canvas_layer;
+
+// area covered by the text fields' black background
+static GRect s_text_area;
+
+// part of each field that an earlier field drew over and must be cleared
+static GRect s_overlaps[FIELD_COUNT];
+
+// text extents, measured when the text changes rather than every frame
+static GSize s_text_sizes[FIELD_COUNT];
+
+#ifdef DIGIT_ATLAS
+// characters in the atlas, one cell each in this order
+#define ATLAS_GLYPHS "0123456789:"
+#define ATLAS_GLYPH_COUNT 11
+
+static GBitmap *s_atlas;
+static GBitmap *s_glyphs[ATLAS_GLYPH_COUNT];  // a sub bitmap per cell
+static GSize s_cell_size;
+#endif
+
+#else
+
+// use a TextLayer element for each field
+static TextLayer *s_text_layers[FIELD_COUNT];
+static TextLayer *s_bt_dis_layer;  // to show the letter b if bluetooth disconnects
+
+static TextLayer *s_seconds_layer;
+
+// layer for the battery bar
+static Layer *s_battery_layer;
+
+static Layer *s_forecast_layer;
+
+// empty layers below and above the rest, to time a whole frame
+static Layer *s_frame_start_layer;
+static Layer *s_frame_end_layer;
+
+#endif
+
+static void set_layout(GRect bounds) {
+#ifndef DIGIT_ATLAS
+	s_time_font = HEAP_TRACE_OBJECT("time font",
+		fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_HELSINKI_48)));
+#endif
+	
+	s_frames[FIELD_DAY] = GRect(0, 0, bounds.size.w, 32);
+	s_fonts[FIELD_DAY] = fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
+	s_alignments[FIELD_DAY] = GTextAlignmentLeft;
+	
+	s_frames[FIELD_TIME] = GRect(0, 32, bounds.size.w, 70);
+	s_fonts[FIELD_TIME] = s_time_font;
+	s_alignments[FIELD_TIME] = GTextAlignmentCenter;
+	
+	s_frames[FIELD_DATE] = GRect(0, 84, bounds.size.w, 38);
+	s_fonts[FIELD_DATE] = fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
+	s_alignments[FIELD_DATE] = GTextAlignmentRight;
+	
+	s_frames[FIELD_CONDITIONS] = GRect(42, 122, 150, 36);
+	s_fonts[FIELD_CONDITIONS] = fonts_get_system_font(FONT_KEY_ROBOTO_CONDENSED_21);
+	s_alignments[FIELD_CONDITIONS] = GTextAlignmentLeft;
+	
+	s_frames[FIELD_TEMPERATURE] = GRect(0, 118, 42, 40);
+	s_fonts[FIELD_TEMPERATURE] = fonts_get_system_font(FONT_KEY_BITHAM_30_BLACK);
+	s_alignments[FIELD_TEMPERATURE] = GTextAlignmentLeft;
+	
+	s_bt_frame = GRect(124, 0, 18, 22);
+	s_battery_frame = GRect(0, 160, 180, 6);
+	s_seconds_frame = GRect(bounds.size.w - 40, s_frames[FIELD_DATE].origin.y, 38, s_frames[FIELD_DATE].size.h);
+	s_forecast_frame = GRect(0, 84, bounds.size.w, 74);
+}
+
+// Draw the battery meter into a frame
+static void draw_battery(GContext *ctx, GRect frame) {
+	bench_begin(BENCH_BATTERY_UPDATE_PROC);
+	
+	// Find the width of the bar (168 px is width of Pebble 2)
+	int width = (s_battery_level * 168) / 100;
+	
+	// Draw the background
+	graphics_context_set_fill_color(ctx, GColorDarkGray);
+	graphics_fill_rect(ctx, frame, 0, GCornerNone);
+	
+	// Draw the bar
+	graphics_context_set_fill_color(ctx, GColorBlack);
+	graphics_fill_rect(ctx, GRect(frame.origin.x, frame.origin.y, width, frame.size.h), 0, GCornerNone);
+	
+	bench_end(BENCH_BATTERY_UPDATE_PROC);
+}
+
+// Draw the forecast strip into a frame, a column per point with the hour,
+// temperature and conditions
+static void draw_forecast(GContext *ctx, GRect frame) {
+	graphics_context_set_fill_color(ctx, GColorBlack);
+	graphics_fill_rect(ctx, frame, 0, GCornerNone);
+	graphics_context_set_stroke_color(ctx, GColorWhite);
+	graphics_draw_line(ctx, frame.origin, GPoint(frame.origin.x + frame.size.w - 1, frame.origin.y));
+	
+	graphics_context_set_text_color(ctx, GColorWhite);
+	GFont small_font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+	GFont large_font = fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD);
+	int width = frame.size.w / DISPLAY_FORECAST_COLUMNS;
+	
+	for(int i = 0; i < s_forecast_count; i++) {
+		int x = frame.origin.x + i * width;
+		int y = frame.origin.y;
+		graphics_draw_text(ctx, s_forecast[i].hour, small_font, GRect(x, y + 2, width, 16),
+			GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+		graphics_draw_text(ctx, s_forecast[i].temperature, large_font, GRect(x, y + 18, width, 28),
+			GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+		graphics_draw_text(ctx, s_forecast[i].condition, small_font, GRect(x, y + 50, width, 16),
+			GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+	}
+}
+
+// Keep a copy of the columns to draw
+static void set_forecast(const DisplayForecastColumn *columns, int count) {
+	s_forecast_count = MIN(count, DISPLAY_FORECAST_COLUMNS);
+	for(int i = 0; i < s_forecast_count; i++) {
+		s_forecast[i] = columns[i];
+	}
+	bench_count_dirty_pixels(s_forecast_frame.size.w * s_forecast_frame.size.h);
+}
+
+// Two digits, or false when the seconds are hidden
+static bool set_seconds_text(int seconds) {
+	s_seconds = seconds;
+	if(seconds < 0) {
+		return false;
+	}
+	s_seconds_text[0] = '0' + seconds / 10;
+	s_seconds_text[1] = '0' + seconds % 10;
+	s_seconds_text[2] = '\0';
+	return true;
+}
+
+#ifdef SINGLE_LAYER_RENDER
+
+static GRect rect_intersection(GRect a, GRect b) {
+	int x0 = MAX(a.origin.x, b.origin.x);
+	int y0 = MAX(a.origin.y, b.origin.y);
+	int x1 = MIN(a.origin.x + a.size.w, b.origin.x + b.size.w);
+	int y1 = MIN(a.origin.y + a.size.h, b.origin.y + b.size.h);
+	
+	if(x1 <= x0 || y1 <= y0) {
+		return GRectZero;
+	}
+	return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+// Smallest rect holding both, where an empty rect adds nothing
+static GRect rect_union(GRect a, GRect b) {
+	if(a.size.w == 0 || a.size.h == 0) {
+		return b;
+	}
+	if(b.size.w == 0 || b.size.h == 0) {
+		return a;
+	}
+	
+	int x0 = MIN(a.origin.x, b.origin.x);
+	int y0 = MIN(a.origin.y, b.origin.y);
+	int x1 = MAX(a.origin.x + a.size.w, b.origin.x + b.size.w);
+	int y1 = MAX(a.origin.y + a.size.h, b.origin.y + b.size.h);
+	return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+#ifdef DIGIT_ATLAS
+static void atlas_load() {
+	s_atlas = HEAP_TRACE_OBJECT("digit atlas", gbitmap_create_with_resource(RESOURCE_ID_IMAGE_DIGIT_ATLAS));
+	
+	// The cells split the atlas evenly
+	GRect bounds = gbitmap_get_bounds(s_atlas);
+	s_cell_size = GSize(bounds.size.w / ATLAS_GLYPH_COUNT, bounds.size.h);
+	for(int i = 0; i < ATLAS_GLYPH_COUNT; i++) {
+		s_glyphs[i] = HEAP_TRACE_OBJECT("digit glyph", gbitmap_create_as_sub_bitmap(s_atlas,
+			GRect(i * s_cell_size.w, 0, s_cell_size.w, s_cell_size.h)));
+	}
+}
+
+static void atlas_unload() {
+	for(int i = 0; i < ATLAS_GLYPH_COUNT; i++) {
+		gbitmap_destroy(s_glyphs[i]);
+	}
+	gbitmap_destroy(s_atlas);
+}
+
+// Every character takes one cell, so no layout is needed
+static GSize atlas_text_size(const char *text) {
+	return GSize(strlen(text) * s_cell_size.w, s_cell_size.h);
+}
+
+// Blit a cell per character, centred in the frame. Characters that are
+// not in the atlas, like the space of a 12 hour time, are left blank.
+static void draw_atlas_text(GContext *ctx, const char *text, GRect frame) {
+	GSize size = atlas_text_size(text);
+	GRect cell = GRect(frame.origin.x + (frame.size.w - size.w) / 2, frame.origin.y,
+		s_cell_size.w, s_cell_size.h);
+	
+	graphics_context_set_compositing_mode(ctx, GCompOpSet);
+	for(const char *c = text; *c; c++) {
+		const char *glyph = strchr(ATLAS_GLYPHS, *c);
+		if(glyph) {
+			graphics_draw_bitmap_in_rect(ctx, s_glyphs[glyph - ATLAS_GLYPHS], cell);
+		}
+		cell.origin.x += s_cell_size.w;
+	}
+}
+#endif
+
+// Measure a field's text, only done when the text changes
+static GSize text_size(DisplayField field) {
+#ifdef DIGIT_ATLAS
+	if(field == FIELD_TIME) {
+		return atlas_text_size(s_text[field]);
+	}
+#endif
+	return graphics_text_layout_get_content_size(s_text[field], s_fonts[field],
+		s_frames[field], GTextOverflowModeWordWrap, s_alignments[field]);
+}
+
+static void draw_field(GContext *ctx, DisplayField field) {
+	if(field != FIELD_TIME) {
+		graphics_draw_text(ctx, s_text[field], s_fonts[field], s_frames[field],
+			GTextOverflowModeWordWrap, s_alignments[field], NULL);
+		return;
+	}
+	
+	bench_begin(BENCH_DRAW_TIME);
+#ifdef DIGIT_ATLAS
+	draw_atlas_text(ctx, s_text[field], s_frames[field]);
+#else
+	graphics_draw_text(ctx, s_text[field], s_fonts[field], s_frames[field],
+		GTextOverflowModeWordWrap, s_alignments[field], NULL);
+#endif
+	bench_end(BENCH_DRAW_TIME);
+}
+
+// Area a field's text covers, from its cached extent and alignment
+static GRect text_rect(DisplayField field) {
+	GRect frame = s_frames[field];
+	GSize size = s_text_sizes[field];
+	int x = frame.origin.x;
+	
+	if(s_alignments[field] == GTextAlignmentCenter) {
+		x += (frame.size.w - size.w) / 2;
+	} else if(s_alignments[field] == GTextAlignmentRight) {
+		x += frame.size.w - size.w;
+	}
+	return GRect(x, frame.origin.y, size.w, size.h);
+}
+
+static void canvas_update_proc(Layer *layer, GContext *ctx) {
+	bench_begin(BENCH_FRAME);
+	telemetry_frame_begin();
+	profile_frame_begin();
+	
+	// One black background for all the text fields
+	graphics_context_set_fill_color(ctx, GColorBlack);
+	graphics_fill_rect(ctx, s_text_area, 0, GCornerNone);
+	
+	graphics_context_set_text_color(ctx, GColorWhite);
+	for(int i = 0; i < FIELD_COUNT; i++) {
+		// Clear only where this field overlaps one drawn before it
+		if(s_overlaps[i].size.h) {
+			graphics_fill_rect(ctx, s_overlaps[i], 0, GCornerNone);
+		}
+		if(!s_hidden[i]) {
+			profile_start(i);
+			draw_field(ctx, i);
+			profile_stop();
+		}
+	}
+	
+	if(s_seconds >= 0) {
+		graphics_draw_text(ctx, s_seconds_text, s_fonts[FIELD_DATE], s_seconds_frame,
+			GTextOverflowModeWordWrap, GTextAlignmentRight, NULL);
+	}
+	
+	// Flag a lost Bluetooth connection
+	if(!s_bt_connected) {
+		profile_start(PROFILE_BLUETOOTH);
+		graphics_context_set_fill_color(ctx, GColorWhite);
+		graphics_fill_rect(ctx, s_bt_frame, 0, GCornerNone);
+		graphics_context_set_text_color(ctx, GColorBlack);
+		graphics_draw_text(ctx, "!B", fonts_get_system_font(FONT_KEY_ROBOTO_CONDENSED_21), s_bt_frame,
+			GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+		profile_stop();
+	}
+	
+	if(s_forecast_count) {
+		profile_start(PROFILE_FORECAST);
+		draw_forecast(ctx, s_forecast_frame);
+		profile_stop();
+	}
+	
+	profile_start(PROFILE_BATTERY);
+	draw_battery(ctx, s_battery_frame);
+	
+	profile_frame_end();
+	telemetry_frame_end();
+	bench_end(BENCH_FRAME);
+}
+
+void display_load(Window *window) {
+	// Get information about the Window
+	Layer *window_layer = window_get_root_layer(window);
+	GRect bounds = layer_get_bounds(window_layer);
+	set_layout(bounds);
+#ifdef DIGIT_ATLAS
+	atlas_load();
+#endif
+	
+	// Precompute the background and the overlaps between fields
+	s_text_area = GRectZero;
+	for(int i = 0; i < FIELD_COUNT; i++) {
+		s_overlaps[i] = GRectZero;
+		for(int j = 0; j < i; j++) {
+			s_overlaps[i] = rect_union(s_overlaps[i], rect_intersection(s_frames[i], s_frames[j]));
+		}
+		s_text_area = rect_union(s_text_area, s_frames[i]);
+		s_text_sizes[i] = GSize(0, 0);
+	}
+	s_text_area = rect_intersection(s_text_area, bounds);
+	
+	s_canvas_layer = HEAP_TRACE_OBJECT("canvas layer", layer_create(bounds));
+	layer_set_update_proc(s_canvas_layer, canvas_update_proc);
+	layer_add_child(window_layer, s_canvas_layer);
+}
+
+void display_unload() {
+	layer_destroy(s_canvas_layer);
+#ifdef DIGIT_ATLAS
+	atlas_unload();
+#else
+	fonts_unload_custom_font(s_time_font);
+#endif
+}
+
+void display_set_text(DisplayField field, const char *text) {
+	if(strcmp(s_text[field], text) == 0) {
+		return;
+	}
+	
+	GRect old_rect = text_rect(field);
+	strncpy(s_text[field], text, DISPLAY_TEXT_SIZE - 1);
+	s_text_sizes[field] = text_size(field);
+	
+	// Pebble recomposes the whole window, but only this area actually changes
+	GRect dirty = rect_union(old_rect, text_rect(field));
+	bench_count_dirty_pixels(dirty.size.w * dirty.size.h);
+	layer_mark_dirty(s_canvas_layer);
+}
+
+void display_set_battery(int percent) {
+	if(percent == s_battery_level) {
+		return;
+	}
+	s_battery_level = percent;
+	
+	bench_count_dirty_pixels(s_battery_frame.size.w * s_battery_frame.size.h);
+	layer_mark_dirty(s_canvas_layer);
+}
+
+void display_set_bluetooth(bool connected) {
+	if(connected == s_bt_connected) {
+		return;
+	}
+	s_bt_connected = connected;
+	
+	bench_count_dirty_pixels(s_bt_frame.size.w * s_bt_frame.size.h);
+	layer_mark_dirty(s_canvas_layer);
+}
+
+void display_set_hidden(DisplayField field, bool hidden) {
+	if(hidden == s_hidden[field]) {
+		return;
+	}
+	s_hidden[field] = hidden;
+	
+	bench_count_dirty_pixels(s_frames[field].size.w * s_frames[field].size.h);
+	layer_mark_dirty(s_canvas_layer);
+}
+
+void display_set_seconds(int seconds) {
+	if(seconds == s_seconds) {
+		return;
+	}
+	set_seconds_text(seconds);
+	
+	// The one layer draws every field again for each second
+	GRect bounds = layer_get_bounds(s_canvas_layer);
+	bench_count_dirty_pixels(bounds.size.w * bounds.size.h);
+	layer_mark_dirty(s_canvas_layer);
+}
+
+void display_set_forecast(const DisplayForecastColumn *columns, int count) {
+	if(count == 0 && s_forecast_count == 0) {
+		return;
+	}
+	set_forecast(columns, count);
+	layer_mark_dirty(s_canvas_layer);
+}
+
+#else
+
+// Layer update procedure for drawing the battery meter
+static void battery_update_proc(Layer *layer, GContext *ctx) {
+	draw_battery(ctx, layer_get_bounds(layer));
+}
+
+static void forecast_update_proc(Layer *layer, GContext *ctx) {
+	draw_forecast(ctx, layer_get_bounds(layer));
+}
+
+// The roll counts the cells that change itself
+static void count_dirty_pixels(GRect rect) {
+	bench_count_dirty_pixels(rect.size.w * rect.size.h);
+}
+
+// The time goes through the digit roll, the other fields to their TextLayer
+static void show_text(DisplayField field, const char *text) {
+	if(field == FIELD_TIME) {
+		digit_anim_set_text(text);
+		return;
+	}
+	bench_count_dirty_pixels(s_frames[field].size.w * s_frames[field].size.h);
+	text_layer_set_text(s_text_layers[field], text);
+}
+
+static void frame_start_update_proc(Layer *layer, GContext *ctx) {
+	bench_begin(BENCH_FRAME);
+	telemetry_frame_begin();
+	profile_frame_begin();
+}
+
+static void frame_end_update_proc(Layer *layer, GContext *ctx) {
+	profile_frame_end();
+	telemetry_frame_end();
+	bench_end(BENCH_FRAME);
+}
+
+void display_load(Window *window) {
+	// Get information about the Window
+	Layer *window_layer = window_get_root_layer(window);
+	GRect bounds = layer_get_bounds(window_layer);
+	set_layout(bounds);
+	
+	s_frame_start_layer = HEAP_TRACE_OBJECT("frame start layer", layer_create(GRectZero));
+	layer_set_update_proc(s_frame_start_layer, frame_start_update_proc);
+	layer_add_child(window_layer, s_frame_start_layer);
+	
+	// Create a TextLayer for each field, white text on black
+	for(int i = 0; i < FIELD_COUNT; i++) {
+		s_text_layers[i] = HEAP_TRACE_OBJECT("text layer", text_layer_create(s_frames[i]));
+		text_layer_set_background_color(s_text_layers[i], GColorBlack);
+		text_layer_set_text_color(s_text_layers[i], GColorClear);
+		text_layer_set_font(s_text_layers[i], s_fonts[i]);
+		text_layer_set_text_alignment(s_text_layers[i], s_alignments[i]);
+		text_layer_set_text(s_text_layers[i], s_hidden[i] ? "" : s_text[i]);
+		profile_add_probe(window_layer, i, text_layer_get_layer(s_text_layers[i]));
+		layer_add_child(window_layer, text_layer_get_layer(s_text_layers[i]));
+	}
+	
+	// The time layer only draws the background, the digits roll in above it
+	TextLayer *time_layer = s_text_layers[FIELD_TIME];
+	text_layer_set_text(time_layer, "");
+	digit_anim_load(text_layer_get_layer(time_layer), layer_get_bounds(text_layer_get_layer(time_layer)),
+		s_fonts[FIELD_TIME], GColorClear, count_dirty_pixels);
+	digit_anim_set_text(s_hidden[FIELD_TIME] ? "" : s_text[FIELD_TIME]);
+	
+	// The seconds sit on the date row, which is blank while they show
+	s_seconds_layer = HEAP_TRACE_OBJECT("seconds layer", text_layer_create(s_seconds_frame));
+	text_layer_set_background_color(s_seconds_layer, GColorBlack);
+	text_layer_set_text_color(s_seconds_layer, GColorWhite);
+	text_layer_set_font(s_seconds_layer, s_fonts[FIELD_DATE]);
+	text_layer_set_text_alignment(s_seconds_layer, GTextAlignmentRight);
+	text_layer_set_text(s_seconds_layer, s_seconds_text);
+	layer_set_hidden(text_layer_get_layer(s_seconds_layer), s_seconds < 0);
+	layer_add_child(window_layer, text_layer_get_layer(s_seconds_layer));
+	
+	// The forecast strip covers the date and the weather while it shows
+	s_forecast_layer = HEAP_TRACE_OBJECT("forecast layer", layer_create(s_forecast_frame));
+	layer_set_update_proc(s_forecast_layer, forecast_update_proc);
+	layer_set_hidden(s_forecast_layer, s_forecast_count == 0);
+	profile_add_probe(window_layer, PROFILE_FORECAST, s_forecast_layer);
+	layer_add_child(window_layer, s_forecast_layer);
+	
+	// Settings for the Bluetooth layer
+	s_bt_dis_layer = HEAP_TRACE_OBJECT("bluetooth layer", text_layer_create(s_bt_frame));
+	text_layer_set_background_color(s_bt_dis_layer, GColorWhite);
+	text_layer_set_text_color(s_bt_dis_layer, GColorBlack);
+	text_layer_set_font(s_bt_dis_layer, fonts_get_system_font(FONT_KEY_ROBOTO_CONDENSED_21));
+	text_layer_set_text_alignment(s_bt_dis_layer, GTextAlignmentLeft);
+	text_layer_set_text(s_bt_dis_layer, "!B");
+	layer_set_hidden(text_layer_get_layer(s_bt_dis_layer), s_bt_connected);
+	profile_add_probe(window_layer, PROFILE_BLUETOOTH, text_layer_get_layer(s_bt_dis_layer));
+	layer_add_child(window_layer, text_layer_get_layer(s_bt_dis_layer));
+	
+	// Create battery meter Layer
+	s_battery_layer = HEAP_TRACE_OBJECT("battery layer", layer_create(s_battery_frame));
+	layer_set_update_proc(s_battery_layer, battery_update_proc);
+	profile_add_probe(window_layer, PROFILE_BATTERY, s_battery_layer);
+	layer_add_child(window_layer, s_battery_layer);
+	
+	s_frame_end_layer = HEAP_TRACE_OBJECT("frame end layer", layer_create(GRectZero));
+	layer_set_update_proc(s_frame_end_layer, frame_end_update_proc);
+	layer_add_child(window_layer, s_frame_end_layer);
+}
+
+// Destroy everything in the reverse order of display_load
+void display_unload() {
+	layer_destroy(s_frame_end_layer);
+	profile_remove_probes();
+	
+	// Destroy the battery layer
+	layer_destroy(s_battery_layer);
+	
+	text_layer_destroy(s_bt_dis_layer);
+	layer_destroy(s_forecast_layer);
+	text_layer_destroy(s_seconds_layer);
+	
+	// Destroy TextLayer
+	digit_anim_unload();
+	for(int i = FIELD_COUNT - 1; i >= 0; i--) {
+		text_layer_destroy(s_text_layers[i]);
+	}
+	layer_destroy(s_frame_start_layer);
+	
+	// The layers using the font are gone
+	fonts_unload_custom_font(s_time_font);
+}
+
+void display_set_text(DisplayField field, const char *text) {
+	if(strcmp(s_text[field], text) == 0) {
+		return;
+	}
+	
+	strncpy(s_text[field], text, DISPLAY_TEXT_SIZE - 1);
+	if(s_hidden[field]) {
+		return;
+	}
+	show_text(field, s_text[field]);
+}
+
+void display_set_battery(int percent) {
+	if(percent == s_battery_level) {
+		return;
+	}
+	s_battery_level = percent;
+	
+	// Update meter
+	bench_count_dirty_pixels(s_battery_frame.size.w * s_battery_frame.size.h);
+	layer_mark_dirty(s_battery_layer);
+}
+
+void display_set_bluetooth(bool connected) {
+	s_bt_connected = connected;
+	
+	// Show icon if disconnected
+	layer_set_hidden(text_layer_get_layer(s_bt_dis_layer), connected);
+}
+
+void display_set_hidden(DisplayField field, bool hidden) {
+	if(hidden == s_hidden[field]) {
+		return;
+	}
+	s_hidden[field] = hidden;
+	
+	// An empty TextLayer still fills its background
+	show_text(field, hidden ? "" : s_text[field]);
+}
+
+// Only the seconds layer is marked dirty, but Pebble still draws every
+// layer of the window again for each second
+void display_set_seconds(int seconds) {
+	if(seconds == s_seconds) {
+		return;
+	}
+	bool shown = set_seconds_text(seconds);
+	
+	bench_count_dirty_pixels(s_seconds_frame.size.w * s_seconds_frame.size.h);
+	layer_set_hidden(text_layer_get_layer(s_seconds_layer), !shown);
+	if(shown) {
+		text_layer_set_text(s_seconds_layer, s_seconds_text);
+	}
+}
+
+void display_set_forecast(const DisplayForecastColumn *columns, int count) {
+	if(count == 0 && s_forecast_count == 0) {
+		return;
+	}
+	set_forecast(columns, count);
+	layer_set_hidden(s_forecast_layer, s_forecast_count == 0);
+	layer_mark_dirty(s_forecast_layer);
+}
+
+#endif
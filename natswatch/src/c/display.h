@@ -0,0 +1,50 @@
+#pragma once
+#include <pebble.h>
+
+// Uncomment to draw the whole face from one Layer instead of a tree of
+// TextLayers. That saves a heap object per field and the overlapping
+// background fills of the TextLayers. The one layer cannot clip a digit
+// to its cell, so the time changes without the roll of digit_anim.h.
+// #define SINGLE_LAYER_RENDER
+
+// Uncomment to draw the time from the pre-rendered digit atlas built by
+// tools/digit_atlas.py instead of laying out the custom font every minute.
+// The font is then never loaded. Needs SINGLE_LAYER_RENDER.
+// #define DIGIT_ATLAS
+
+// text fields on the face, in the order they are drawn
+typedef enum {
+	FIELD_DAY,
+	FIELD_TIME,
+	FIELD_DATE,
+	FIELD_CONDITIONS,
+	FIELD_TEMPERATURE,
+	FIELD_COUNT
+} DisplayField;
+
+// columns in the forecast strip
+#define DISPLAY_FORECAST_COLUMNS 4
+
+typedef struct {
+	char hour[6];
+	char temperature[6];
+	const char *condition;
+} DisplayForecastColumn;
+
+void display_load(Window *window);
+void display_unload(void);
+
+// These only redraw when the value actually changed
+void display_set_text(DisplayField field, const char *text);
+void display_set_battery(int percent);
+void display_set_bluetooth(bool connected);
+
+// Leave a field blank but keep its text for when it is shown again
+void display_set_hidden(DisplayField field, bool hidden);
+
+// Show the seconds at the right of the date row, -1 hides them. They draw
+// over the date, so hide the date while they show.
+void display_set_seconds(int seconds);
+
+// Show the forecast strip over the date and the weather, a count of 0 hides it
+void display_set_forecast(const DisplayForecastColumn *columns, int count);
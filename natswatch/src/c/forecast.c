@@ -0,0 +1,81 @@
+#include "forecast.h"
+
+// persistent storage key, between natswatch.c's and telemetry.c's
+#define PERSIST_KEY_FORECAST 1
+
+// ask for a new forecast once less than this much of it lies ahead
+#define FORECAST_MIN_AHEAD (12 * SECONDS_PER_HOUR)
+
+typedef struct {
+	time_t start;  // time of the first point, 0 if there is no forecast
+	uint8_t count;
+	ForecastPoint points[FORECAST_POINTS];
+} Forecast;
+
+static Forecast s_forecast;
+
+// the forecast being reassembled, and the chunk expected next
+static Forecast s_incoming;
+static int s_next_sequence = -1;  // -1 until a first chunk arrives
+
+void forecast_init() {
+	if(persist_read_data(PERSIST_KEY_FORECAST, &s_forecast, sizeof(s_forecast)) != sizeof(s_forecast)) {
+		s_forecast.start = 0;
+		s_forecast.count = 0;
+	}
+}
+
+bool forecast_receive(const uint8_t *data, uint16_t length) {
+	if(length < FORECAST_HEADER_SIZE || data[0] != FORECAST_FORMAT_VERSION) {
+		return false;
+	}
+	
+	int sequence = data[1];
+	bool last = data[2];
+	time_t start = data[3] | data[4] << 8 | data[5] << 16 | (uint32_t)data[6] << 24;
+	
+	// A first chunk starts over, a missing or stray chunk drops the rest
+	if(sequence == 0) {
+		memset(&s_incoming, 0, sizeof(s_incoming));
+		s_incoming.start = start;
+		s_next_sequence = 0;
+	}
+	if(sequence != s_next_sequence || start != s_incoming.start) {
+		APP_LOG(APP_LOG_LEVEL_WARNING, "Dropping forecast, chunk %d out of order", sequence);
+		s_next_sequence = -1;
+		return false;
+	}
+	s_next_sequence++;
+	
+	for(int i = FORECAST_HEADER_SIZE; i + 1 < length && s_incoming.count < FORECAST_POINTS; i += 2) {
+		s_incoming.points[s_incoming.count++] = (ForecastPoint) {
+			.temperature = (int8_t)data[i],
+			.condition = data[i + 1]
+		};
+	}
+	
+	if(!last) {
+		return false;
+	}
+	s_forecast = s_incoming;
+	s_next_sequence = -1;
+	persist_write_data(PERSIST_KEY_FORECAST, &s_forecast, sizeof(s_forecast));
+	APP_LOG(APP_LOG_LEVEL_DEBUG, "Forecast of %d points received", s_forecast.count);
+	return true;
+}
+
+bool forecast_is_due(time_t now) {
+	time_t end = s_forecast.start + s_forecast.count * FORECAST_STEP;
+	return s_forecast.count == 0 || now >= end - FORECAST_MIN_AHEAD;
+}
+
+int forecast_upcoming(time_t now, ForecastPoint *points, time_t *times, int max) {
+	int first = now > s_forecast.start ? (now - s_forecast.start) / FORECAST_STEP : 0;
+	int count = 0;
+	
+	for(int i = first; i < s_forecast.count && count < max; i++, count++) {
+		points[count] = s_forecast.points[i];
+		times[count] = s_forecast.start + i * FORECAST_STEP;
+	}
+	return count;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <pebble.h>
+
+#define KEY_FORECAST 6  // one chunk of the forecast from the phone
+
+// points in a forecast, FORECAST_STEP apart
+#define FORECAST_POINTS 8
+#define FORECAST_STEP (3 * SECONDS_PER_HOUR)
+
+// The phone sends the forecast in chunks small enough for the inbox that
+// the current weather needs, one byte array tuple each:
+// [0] format version, [1] sequence number from 0, [2] 1 on the last chunk,
+// [3..6] time of the first point as uint32 little endian, then up to
+// FORECAST_CHUNK_POINTS points of temperature in C as int8 and a
+// condition code
+#define FORECAST_FORMAT_VERSION 1
+#define FORECAST_HEADER_SIZE 7
+#define FORECAST_CHUNK_POINTS 4
+#define FORECAST_CHUNK_SIZE (FORECAST_HEADER_SIZE + 2 * FORECAST_CHUNK_POINTS)
+
+typedef struct {
+	int8_t temperature;
+	uint8_t condition;
+} ForecastPoint;
+
+// Restore the last forecast from persistent storage
+void forecast_init(void);
+
+// Add a chunk from the phone, true once it completes a new forecast
+bool forecast_receive(const uint8_t *data, uint16_t length);
+
+// Whether to ask the phone for a new forecast with the next weather request
+bool forecast_is_due(time_t now);
+
+// Copy up to max points from the one covering now on, with their times,
+// returning how many there are
+int forecast_upcoming(time_t now, ForecastPoint *points, time_t *times, int max);
@@ -0,0 +1,153 @@
+#include "frame_capture.h"
+#include "event_trace.h"
+
+#ifdef FRAME_CAPTURE
+
+// bytes of a row logged per line, as hex
+#define FRAME_CAPTURE_SEGMENT 48
+
+// 32 bit FNV-1a over every visible pixel, top to bottom
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+static Layer *s_capture_layer;
+
+// the frame before, to see which pixels changed
+static uint8_t *s_previous;
+static int s_stride;
+
+static uint32_t s_frame_number;
+
+// pixels changed by the frames of the current minute
+static FrameCaptureClock s_clock;  // NULL for time()
+static time_t s_minute;
+static int s_minute_frames;
+static uint32_t s_minute_changed;
+
+static int pixel(const uint8_t *row, int x, int bits) {
+	return bits == 8 ? row[x] : (row[x / 8] >> (x % 8)) & 1;
+}
+
+static void set_pixel(uint8_t *row, int x, int bits, int value) {
+	if(bits == 8) {
+		row[x] = value;
+	} else if(value) {
+		row[x / 8] |= 1 << (x % 8);
+	} else {
+		row[x / 8] &= ~(1 << (x % 8));
+	}
+}
+
+#ifdef FRAME_CAPTURE_DUMP
+static void dump_frame(GBitmap *frame, GRect bounds, int bits) {
+	APP_LOG(APP_LOG_LEVEL_INFO, "frame %lu size %dx%d bits %d", (unsigned long)s_frame_number,
+		bounds.size.w, bounds.size.h, bits);
+	
+	char hex[FRAME_CAPTURE_SEGMENT * 2 + 1];
+	for(int y = 0; y < bounds.size.h; y++) {
+		GBitmapDataRowInfo info = gbitmap_get_data_row_info(frame, y);
+		int first = info.min_x * bits / 8;
+		int last = info.max_x * bits / 8;
+		for(int start = first; start <= last; start += FRAME_CAPTURE_SEGMENT) {
+			int length = MIN(FRAME_CAPTURE_SEGMENT, last - start + 1);
+			for(int i = 0; i < length; i++) {
+				snprintf(hex + 2 * i, 3, "%02x", info.data[start + i]);
+			}
+			APP_LOG(APP_LOG_LEVEL_INFO, "frame %lu row %d byte %d %s", (unsigned long)s_frame_number,
+				y, start, hex);
+		}
+	}
+}
+#endif
+
+static void count_minute(uint32_t changed) {
+	time_t minute = (s_clock ? s_clock(NULL) : time(NULL)) / SECONDS_PER_MINUTE;
+	if(minute != s_minute) {
+		if(s_minute_frames) {
+			APP_LOG(APP_LOG_LEVEL_INFO, "frame minute: frames=%d changed=%lu", s_minute_frames,
+				(unsigned long)s_minute_changed);
+		}
+		s_minute = minute;
+		s_minute_frames = 0;
+		s_minute_changed = 0;
+	}
+	s_minute_frames++;
+	s_minute_changed += changed;
+}
+
+// Drawn after every other layer, so the frame buffer holds the whole frame
+static void capture_update_proc(Layer *layer, GContext *ctx) {
+	GBitmap *frame = graphics_capture_frame_buffer(ctx);
+	if(!frame) {
+		return;
+	}
+	GRect bounds = gbitmap_get_bounds(frame);
+	int bits = gbitmap_get_format(frame) == GBitmapFormat1Bit ? 1 : 8;
+	
+	bool first = !s_previous;
+	if(first) {
+		s_stride = (bounds.size.w * bits + 7) / 8;
+		s_previous = malloc(s_stride * bounds.size.h);
+		if(!s_previous) {
+			APP_LOG(APP_LOG_LEVEL_WARNING, "No heap for the previous frame, not capturing");
+			graphics_release_frame_buffer(ctx, frame);
+			return;
+		}
+	}
+	
+	uint32_t hash = FNV_OFFSET;
+	uint32_t changed = 0;
+	int x0 = bounds.size.w, y0 = bounds.size.h, x1 = 0, y1 = 0;
+	for(int y = 0; y < bounds.size.h; y++) {
+		GBitmapDataRowInfo info = gbitmap_get_data_row_info(frame, y);
+		uint8_t *previous = s_previous + y * s_stride;
+		for(int x = info.min_x; x <= info.max_x; x++) {
+			int value = pixel(info.data, x, bits);
+			hash = (hash ^ value) * FNV_PRIME;
+			if(first || value != pixel(previous, x, bits)) {
+				set_pixel(previous, x, bits, value);
+				changed++;
+				x0 = MIN(x0, x);
+				y0 = MIN(y0, y);
+				x1 = MAX(x1, x + 1);
+				y1 = MAX(y1, y + 1);
+			}
+		}
+	}
+	
+	if(changed) {
+		APP_LOG(APP_LOG_LEVEL_INFO, "frame %lu hash %08lx changed %lu in %d,%d %dx%d",
+			(unsigned long)s_frame_number, (unsigned long)hash, (unsigned long)changed,
+			x0, y0, x1 - x0, y1 - y0);
+	} else {
+		APP_LOG(APP_LOG_LEVEL_INFO, "frame %lu hash %08lx changed 0", (unsigned long)s_frame_number,
+			(unsigned long)hash);
+	}
+	count_minute(changed);
+	
+#ifdef FRAME_CAPTURE_DUMP
+	dump_frame(frame, bounds, bits);
+#endif
+	
+	graphics_release_frame_buffer(ctx, frame);
+	s_frame_number++;
+}
+
+void frame_capture_set_clock(FrameCaptureClock clock) {
+	s_clock = clock;
+}
+
+void frame_capture_load(Layer *window_layer) {
+	s_capture_layer = layer_create(GRectZero);
+	layer_set_update_proc(s_capture_layer, capture_update_proc);
+	layer_add_child(window_layer, s_capture_layer);
+}
+
+void frame_capture_unload() {
+	layer_destroy(s_capture_layer);
+	s_capture_layer = NULL;
+	free(s_previous);
+	s_previous = NULL;
+}
+
+#endif
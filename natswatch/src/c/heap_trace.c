@@ -0,0 +1,60 @@
+#include "heap_trace.h"
+
+#ifdef HEAP_TRACE
+
+static const char *s_point_names[] = { "load start", "load end", "unload start", "unload end" };
+
+// objects can be traced inside the call that creates another
+#define HEAP_TRACE_DEPTH 4
+
+static size_t s_load_start;  // heap used before the window loaded
+static size_t s_object_start[HEAP_TRACE_DEPTH];
+static int s_depth;
+
+// Highest use seen at any traced point. The SDK has no real high-water
+// mark, so a peak between two points is missed.
+static size_t s_peak;
+
+static size_t sample() {
+	size_t used = heap_bytes_used();
+	if(used > s_peak) {
+		s_peak = used;
+	}
+	return used;
+}
+
+void heap_trace_point(HeapTracePoint point) {
+	size_t used = sample();
+	
+	APP_LOG(APP_LOG_LEVEL_INFO, "heap %s: used=%u free=%u peak=%u", s_point_names[point],
+		(unsigned)used, (unsigned)heap_bytes_free(), (unsigned)s_peak);
+	
+	if(point == HEAP_LOAD_START) {
+		s_load_start = used;
+	} else if(point == HEAP_UNLOAD_END && used != s_load_start) {
+		APP_LOG(APP_LOG_LEVEL_WARNING, "heap leak: unload left %d bytes behind",
+			(int)used - (int)s_load_start);
+	}
+}
+
+void heap_trace_begin() {
+	if(s_depth < HEAP_TRACE_DEPTH) {
+		s_object_start[s_depth] = sample();
+	}
+	s_depth++;
+}
+
+void heap_trace_end(const char *name) {
+	s_depth--;
+	if(s_depth < HEAP_TRACE_DEPTH) {
+		APP_LOG(APP_LOG_LEVEL_DEBUG, "heap object %s: %d bytes", name,
+			(int)(sample() - s_object_start[s_depth]));
+	}
+}
+
+void *heap_trace_object(const char *name, void *object) {
+	heap_trace_end(name);
+	return object;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <pebble.h>
+
+// Uncomment to log heap use at each point of the window lifecycle, the size
+// of every object created while loading, and the high-water mark. Anything
+// unload leaves behind is logged as a leak.
+// #define HEAP_TRACE
+
+// points in the window lifecycle
+typedef enum {
+	HEAP_LOAD_START,
+	HEAP_LOAD_END,
+	HEAP_UNLOAD_START,
+	HEAP_UNLOAD_END
+} HeapTracePoint;
+
+#ifdef HEAP_TRACE
+
+void heap_trace_point(HeapTracePoint point);
+void heap_trace_begin(void);
+void heap_trace_end(const char *name);
+void *heap_trace_object(const char *name, void *object);
+
+// Log the heap an object took to create, evaluating to the object
+#define HEAP_TRACE_OBJECT(name, create) (heap_trace_begin(), heap_trace_object(name, (create)))
+
+// The same for a call that creates things without returning them, which
+// may trace the objects it creates as well
+#define HEAP_TRACE_CALL(name, call) (heap_trace_begin(), (call), heap_trace_end(name))
+
+#else
+
+#define heap_trace_point(point)
+#define HEAP_TRACE_OBJECT(name, create) (create)
+#define HEAP_TRACE_CALL(name, call) (call)
+
+#endif
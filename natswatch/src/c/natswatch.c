@@ -1,241 +1,650 @@
 #include <pebble.h>
+#include "bench.h"
+#include "bt_debounce.h"
+#include "display.h"
+#include "event_trace.h"
+#include "forecast.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
+#include "outbox.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "time_format.h"
 
-#define KEY_TEMPERATURE 0
-#define KEY_CONDITIONS 1
+#define KEY_REQUEST 0  // watch asks the phone for weather, with REQUEST_ flags
+#define KEY_WEATHER 2  // packed weather report from the phone
+#define KEY_WEATHER_TIME 3  // new fetch time for an unchanged report
+#define KEY_LOCATION_AGE 4  // minutes since the phone's location fix
+// KEY_TELEMETRY is in telemetry.h, KEY_FORECAST in forecast.h, KEY_PROFILE in profile.h
+
+// flags in a weather request
+#define REQUEST_FULL_REPORT 1  // the watch has no report cached
+#define REQUEST_FORECAST 2  // the cached forecast is running out
+
+// Packed weather report, one byte array tuple:
+// [0] format version, [1] WeatherCondition, [2] temperature in C as int8,
+// [3..6] fetch time in seconds since the epoch, little endian
+#define WEATHER_FORMAT_VERSION 1
+#define WEATHER_PACKED_SIZE 7
+
+// persistent storage keys, forecast.c uses 1 and telemetry.c 10 and up
+#define PERSIST_KEY_WEATHER 0
+
+// cached weather older than this is marked as stale
+#define WEATHER_STALE_AGE (2 * SECONDS_PER_HOUR)
+
+// how often to refresh the weather, and how often on a low battery
+#define WEATHER_REFRESH_INTERVAL (30 * SECONDS_PER_MINUTE)
+#define WEATHER_LOW_BATTERY_INTERVAL (2 * SECONDS_PER_HOUR)
+
+// Power saving tiers, unless charging. At POWER_SAVER_PERCENT the weather
+// refreshes less often and a disconnect no longer vibrates. At
+// POWER_CRITICAL_PERCENT the weather is not fetched or shown at all.
+#define POWER_SAVER_PERCENT 20
+#define POWER_CRITICAL_PERCENT 10
+
+// give up on a reply after this long, then retry with exponential backoff
+#define WEATHER_REPLY_TIMEOUT (2 * SECONDS_PER_MINUTE)
+#define WEATHER_BACKOFF_MIN (2 * SECONDS_PER_MINUTE)
+#define WEATHER_BACKOFF_MAX (2 * SECONDS_PER_HOUR)
+
+// Sleep mode ticks hourly and fetches no weather. It starts at night, from
+// SLEEP_START_HOUR up to SLEEP_END_HOUR, or once the wrist has been still
+// for SLEEP_IDLE_TIME. A wrist flick wakes the face, and at night it stays
+// awake for SLEEP_WAKE_TIME after the last flick.
+#define SLEEP_START_HOUR 0
+#define SLEEP_END_HOUR 7
+#define SLEEP_IDLE_TIME (30 * SECONDS_PER_MINUTE)
+#define SLEEP_WAKE_TIME (2 * SECONDS_PER_MINUTE)
+
+// how long a wrist flick shows the forecast strip, in ms
+#define FORECAST_SHOW_TIME 5000
+
+// Seconds mode, for workouts, ticks every second and updates only the
+// seconds. A double flick, two within SECONDS_DOUBLE_TAP ms, turns it on or
+// off, and it goes back to minute ticks after SECONDS_MODE_TIMEOUT.
+#define SECONDS_DOUBLE_TAP 600
+#define SECONDS_MODE_TIMEOUT (60 * SECONDS_PER_MINUTE)
+
+typedef enum {
+	POWER_FULL,
+	POWER_SAVER,
+	POWER_CRITICAL
+} PowerTier;
+
+static const char *s_power_tier_names[] = { "full", "saver", "critical" };
+
+// condition codes sent by the phone, in the same order as the JS table
+typedef enum {
+	CONDITION_UNKNOWN,
+	CONDITION_THUNDERSTORM,
+	CONDITION_DRIZZLE,
+	CONDITION_RAIN,
+	CONDITION_SNOW,
+	CONDITION_CLEAR,
+	CONDITION_CLOUDS,
+	CONDITION_MIST,
+	CONDITION_SMOKE,
+	CONDITION_HAZE,
+	CONDITION_DUST,
+	CONDITION_FOG,
+	CONDITION_SAND,
+	CONDITION_ASH,
+	CONDITION_SQUALL,
+	CONDITION_TORNADO,
+	CONDITION_COUNT
+} WeatherCondition;
+
+static const char *s_condition_names[CONDITION_COUNT] = {
+	"", "Thunderstorm", "Drizzle", "Rain", "Snow", "Clear", "Clouds", "Mist",
+	"Smoke", "Haze", "Dust", "Fog", "Sand", "Ash", "Squall", "Tornado"
+};
+
+// last weather report from the phone, kept packed in persistent storage
+typedef struct {
+	int8_t temperature;
+	uint8_t condition;
+	time_t timestamp;  // when the phone fetched the report, 0 if there is none
+} WeatherCache;
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
 
-// integer to store battery level percentage
-static int s_battery_level;
+static WeatherCache s_weather;
+static bool s_weather_stale;
 
-// use a TextLayer element to add to the Window
-static TextLayer *s_time_layer;
-static TextLayer *s_day_layer;  // this will be for the day of the week
-static TextLayer *s_date_layer;  // to hold the date
-static TextLayer *s_weather_layer; // for the weather conditions layer
-static TextLayer *s_temp_layer;  // for the temperature layer
-static TextLayer *s_bt_dis_layer;  // to show the letter b if bluetooth disconnects
+// weather request scheduling
+static time_t s_request_sent;  // when the pending request went out, 0 if none
+static time_t s_retry_at;  // no requests before this after a failure
+static int s_backoff;  // current retry delay in seconds, 0 after a success
+static bool s_connected = true;  // last known phone connection state
 
-// layer for the battery bar
-static Layer *s_battery_layer;
+static PowerTier s_power_tier = POWER_FULL;
 
-static GFont s_time_font;
 
-static void update_time() {
-	// Get a tm structure
-	time_t temp = time(NULL);
-	struct tm *tick_time = localtime(&temp);
+// hides the forecast strip again, NULL while it is hidden
+static AppTimer *s_forecast_timer;
+
+// text of the time fields, reformatted when the tm members behind them change
+static TimeFormatter s_time_format;
+
+// sleep mode
+static bool s_sleeping;
+static time_t s_last_motion;  // last wrist flick, or when the face started
+
+// seconds mode
+static bool s_seconds_mode;
+static time_t s_seconds_mode_end;
+static uint32_t s_last_tap_ms;  // 0 once a tap has been used up by a double flick
+
+// Pass on only the fields whose tm members changed, which time_format_update
+// finds without the units the tick changed
+static void update_time(struct tm *tick_time) {
+	bench_begin(BENCH_UPDATE_TIME);
+	
+	int changed = time_format_update(&s_time_format, tick_time);
+	if(changed & TIME_FORMAT_DAY) {
+		display_set_text(FIELD_DAY, s_time_format.day);
+	}
+	if(changed & TIME_FORMAT_DATE) {
+		display_set_text(FIELD_DATE, s_time_format.date);
+	}
+	if(changed & TIME_FORMAT_TIME) {
+		display_set_text(FIELD_TIME, s_time_format.time);
+	}
 	
-	//Write the current hours and minutes into a buffer
-	static char s_buffer[8];  // buffer for hours and minutes
-	static char s_daybuffer[10];  // buffer for day of week
-	static char s_datebuffer[16]; // buffer for month day
+	bench_end(BENCH_UPDATE_TIME);
+}
+
+static bool weather_is_stale() {
+	return time(NULL) - s_weather.timestamp > WEATHER_STALE_AGE;
+}
+
+// Refresh less often when the battery is low and not charging
+static int weather_interval() {
+	return s_power_tier == POWER_FULL ? WEATHER_REFRESH_INTERVAL : WEATHER_LOW_BATTERY_INTERVAL;
+}
+
+// Back off exponentially after a request or its reply is lost
+static void weather_request_failed() {
+	s_request_sent = 0;
+	s_backoff = s_backoff ? MIN(s_backoff * 2, WEATHER_BACKOFF_MAX) : WEATHER_BACKOFF_MIN;
+	s_retry_at = time(NULL) + s_backoff;
+	APP_LOG(APP_LOG_LEVEL_WARNING, "Weather request failed, retrying in %ds", s_backoff);
+}
+
+// Clear the pending request and any backoff
+static void weather_request_done() {
+	s_request_sent = 0;
+	s_backoff = 0;
+	s_retry_at = 0;
+}
+
+static void request_weather() {
+	// The queue sends it once the outbox is free, and drops it if no reply
+	// could arrive in time anyway
+	// The forecast comes along when it is due, so it costs no requests of its own
+	uint8_t flags = s_weather.timestamp ? 0 : REQUEST_FULL_REPORT;
+	if(forecast_is_due(time(NULL))) {
+		flags |= REQUEST_FORECAST;
+	}
 	
-	strftime(s_daybuffer, sizeof(s_daybuffer), "%A", tick_time); // full day format
-	text_layer_set_text(s_day_layer, s_daybuffer);
-		
-	strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ? "%H:%M" : "%l:%M", tick_time); 
-	text_layer_set_text(s_time_layer, s_buffer); // display this time on text_layer
+	if(!outbox_send_uint8(KEY_REQUEST, flags, WEATHER_REPLY_TIMEOUT)) {
+		weather_request_failed();
+		return;
+	}
+	s_request_sent = time(NULL);
+}
 
-	strftime(s_datebuffer, sizeof(s_datebuffer), "%B %e", tick_time); // date
-	text_layer_set_text(s_date_layer, s_datebuffer);
+// Ask the phone for weather once the cached report is due for a refresh,
+// with at most one request in flight and none while the phone is away
+static void schedule_weather() {
+	time_t now = time(NULL);
+	
+	// No weather at all on a critical battery
+	if(s_power_tier == POWER_CRITICAL) {
+		return;
+	}
 	
+	// Wait for the pending reply, treating a timeout as a failure
+	if(s_request_sent) {
+		if(now - s_request_sent < WEATHER_REPLY_TIMEOUT) {
+			return;
+		}
+		weather_request_failed();
+	}
+	
+	if(!s_connected || now < s_retry_at) {
+		return;
+	}
+	
+	if(now - s_weather.timestamp >= weather_interval()) {
+		request_weather();
+	}
 }
 
-// callback to store the current charge percentage
-static void battery_callback(BatteryChargeState state) {
-	// Record the new battery level
-	s_battery_level = state.charge_percent;
+// Catch up straight away when the phone comes back instead of waiting out
+// the backoff
+static void weather_connection_changed(bool connected) {
+	bool reconnected = connected && !s_connected;
+	s_connected = connected;
+	
+	if(reconnected) {
+		weather_request_done();
+		schedule_weather();
+	}
+}
+
+// Unpack a weather report, rejecting short records and other format versions
+static bool weather_unpack(const uint8_t *data, uint16_t length, WeatherCache *weather) {
+	if(length < WEATHER_PACKED_SIZE || data[0] != WEATHER_FORMAT_VERSION) {
+		return false;
+	}
 	
-	// Update meter
-	layer_mark_dirty(s_battery_layer);
+	weather->condition = data[1] < CONDITION_COUNT ? data[1] : CONDITION_UNKNOWN;
+	weather->temperature = (int8_t)data[2];
+	weather->timestamp = data[3] | data[4] << 8 | data[5] << 16 | (uint32_t)data[6] << 24;
+	return true;
 }
 
-// Layer update procedure for drawing the battery meter
-static void battery_update_proc(Layer *layer, GContext *ctx) {
-	GRect bounds = layer_get_bounds(layer);
+static void weather_pack(const WeatherCache *weather, uint8_t *data) {
+	uint32_t timestamp = weather->timestamp;
+	
+	data[0] = WEATHER_FORMAT_VERSION;
+	data[1] = weather->condition;
+	data[2] = (uint8_t)weather->temperature;
+	data[3] = timestamp;
+	data[4] = timestamp >> 8;
+	data[5] = timestamp >> 16;
+	data[6] = timestamp >> 24;
+}
+
+// Keep the report for the next launch
+static void save_weather() {
+	uint8_t packed[WEATHER_PACKED_SIZE];
+	weather_pack(&s_weather, packed);
+	persist_write_data(PERSIST_KEY_WEATHER, packed, sizeof(packed));
+}
+
+// Show the cached weather, with a ? after the temperature once it is stale
+static void show_weather() {
+	char text[8];
 	
-	// Find the width of the bar (168 px is width of Pebble 2)
-	int width = (s_battery_level * 168) / 100;
+	// Nothing received yet
+	if(s_weather.timestamp == 0) {
+		return;
+	}
 	
-	// Draw the background
-	graphics_context_set_fill_color(ctx, GColorDarkGray);
-	graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+	s_weather_stale = weather_is_stale();
+	snprintf(text, sizeof(text), s_weather_stale ? "%d?" : "%d", (int)s_weather.temperature);
+	display_set_text(FIELD_TEMPERATURE, text);
+	display_set_text(FIELD_CONDITIONS, s_condition_names[s_weather.condition]);
+}
+
+// Long names do not fit a column of the forecast strip
+static const char *condition_short_name(uint8_t condition) {
+	if(condition >= CONDITION_COUNT) {
+		return "";
+	}
+	return condition == CONDITION_THUNDERSTORM ? "Storm" : s_condition_names[condition];
+}
+
+// Fill the forecast strip from the stored forecast, without asking the phone
+static void show_forecast() {
+	ForecastPoint points[DISPLAY_FORECAST_COLUMNS];
+	time_t times[DISPLAY_FORECAST_COLUMNS];
+	DisplayForecastColumn columns[DISPLAY_FORECAST_COLUMNS];
+	int count = forecast_upcoming(time(NULL), points, times, DISPLAY_FORECAST_COLUMNS);
+	
+	for(int i = 0; i < count; i++) {
+		int hour = localtime(&times[i])->tm_hour;
+		if(clock_is_24h_style()) {
+			snprintf(columns[i].hour, sizeof(columns[i].hour), "%02d", hour);
+		} else {
+			snprintf(columns[i].hour, sizeof(columns[i].hour), "%d%s",
+				hour % 12 ? hour % 12 : 12, hour < 12 ? "am" : "pm");
+		}
+		snprintf(columns[i].temperature, sizeof(columns[i].temperature), "%d", points[i].temperature);
+		columns[i].condition = condition_short_name(points[i].condition);
+	}
+	display_set_forecast(columns, count);
+}
+
+static void hide_forecast(void *data) {
+	s_forecast_timer = NULL;
+	display_set_forecast(NULL, 0);
+}
+
+// The weather fields are optional
+static void show_power_tier() {
+	bool hidden = s_power_tier == POWER_CRITICAL;
+	display_set_hidden(FIELD_TEMPERATURE, hidden);
+	display_set_hidden(FIELD_CONDITIONS, hidden);
+}
+
+static PowerTier power_tier(BatteryChargeState state) {
+	if(state.is_charging || state.is_plugged) {
+		return POWER_FULL;
+	}
+	if(state.charge_percent <= POWER_CRITICAL_PERCENT) {
+		return POWER_CRITICAL;
+	}
+	if(state.charge_percent <= POWER_SAVER_PERCENT) {
+		return POWER_SAVER;
+	}
+	return POWER_FULL;
+}
+
+static void set_seconds_mode(bool on);
+
+// Apply the power policy for the current battery state
+static void set_power_tier(BatteryChargeState state) {
+	PowerTier tier = power_tier(state);
+	if(tier == s_power_tier) {
+		return;
+	}
 	
-	// Draw the bar
-	graphics_context_set_fill_color(ctx, GColorBlack);
-	graphics_fill_rect(ctx, GRect(0, 0, width, bounds.size.h), 0, GCornerNone);
+	APP_LOG(APP_LOG_LEVEL_INFO, "Power policy %s -> %s at %d%%%s", s_power_tier_names[s_power_tier],
+		s_power_tier_names[tier], state.charge_percent, state.is_charging ? " charging" : "");
+	s_power_tier = tier;
 	
+	if(window_is_loaded(s_main_window)) {
+		show_power_tier();
+	}
+	if(tier == POWER_CRITICAL) {
+		set_seconds_mode(false);
+	}
+}
+
+// callback to store the current charge percentage
+static void battery_callback(BatteryChargeState state) {
+	// Record the new battery level and update the meter
+	display_set_battery(state.charge_percent);
+	set_power_tier(state);
+	telemetry_battery(state);
+}
+
+// The debounced connection, see bt_debounce.h
+static void show_bluetooth(bool disconnected, bool alert) {
+	// Show icon if disconnected
+	display_set_bluetooth(!disconnected);
+	
+	if(alert && s_power_tier == POWER_FULL) {
+		// Issue a vibrating alert
+		vibes_double_pulse();
+		telemetry_count(TELEMETRY_VIBES);
+	}
 }
 
 // Set up Bluetooth service subscription
 static void bluetooth_callback(bool connected) {
-  // Show icon if disconnected
-  layer_set_hidden(text_layer_get_layer(s_bt_dis_layer), connected);
-
-  if(!connected) {
-    // Issue a vibrating alert
-    vibes_double_pulse();
+  if(connected != s_connected) {
+    telemetry_count(TELEMETRY_BT_FLIPS);
   }
+  
+  // Messages and weather follow the link straight away
+  outbox_set_connected(connected);
+  weather_connection_changed(connected);
+  
+  bt_debounce_update(connected);
 }
 
 // handler function
 static void main_window_load(Window *window) {
-	// Get information about the Window
-	Layer *window_layer = window_get_root_layer(window);
-	GRect bounds = layer_get_bounds(window_layer);
-	s_time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_HELSINKI_48));
-	
-	// Create the TextLayer with specific bounds
-	s_day_layer = text_layer_create(
-		GRect(0, 0, bounds.size.w, 32));
-	s_time_layer = text_layer_create(
-		GRect(0, 32, bounds.size.w, 70));
-	s_date_layer = text_layer_create(
-		GRect(0, 84, bounds.size.w, 38));
-	s_temp_layer = text_layer_create(
-		GRect(0, 118, 42, 40));
-	s_weather_layer = text_layer_create(
-		GRect(42, 122, 150, 36));
-	s_bt_dis_layer = text_layer_create(
-		GRect(124, 0, 18, 22));
-	
-	// Create battery meter Layer
-	s_battery_layer = layer_create(GRect(0, 160, 180, 6));
-	layer_set_update_proc(s_battery_layer, battery_update_proc);
-	
-	// Settings for the day layer
-	text_layer_set_background_color(s_day_layer, GColorBlack);
-	text_layer_set_text_color(s_day_layer, GColorClear);
-	text_layer_set_font(s_day_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD));
-	text_layer_set_text_alignment(s_day_layer, GTextAlignmentLeft);
-
-	// Settings for the time layer
-	text_layer_set_background_color(s_time_layer, GColorBlack);
-	text_layer_set_text_color(s_time_layer, GColorClear);
-	text_layer_set_font(s_time_layer, s_time_font);
-	text_layer_set_text_alignment(s_time_layer, GTextAlignmentCenter);
-	
-	// Settings for the date layer
-	text_layer_set_background_color(s_date_layer, GColorBlack);
-	text_layer_set_text_color(s_date_layer, GColorClear);
-	text_layer_set_font(s_date_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD));
-	text_layer_set_text_alignment(s_date_layer, GTextAlignmentRight);
-	
-	// Settings for the weather layer
-	text_layer_set_background_color(s_weather_layer, GColorBlack);
-	text_layer_set_text_color(s_weather_layer, GColorClear);
-	text_layer_set_font(s_weather_layer, fonts_get_system_font(FONT_KEY_ROBOTO_CONDENSED_21));
-	text_layer_set_text_alignment(s_weather_layer, GTextAlignmentLeft);
-	// text_layer_set_text(s_weather_layer, "12C Cloudy");  // Placeholder
-	
-	// Settings for the temperature layer
-	text_layer_set_background_color(s_temp_layer, GColorBlack);
-	text_layer_set_text_color(s_temp_layer, GColorClear);
-	text_layer_set_font(s_temp_layer, fonts_get_system_font(FONT_KEY_BITHAM_30_BLACK));
-	text_layer_set_text_alignment(s_temp_layer, GTextAlignmentLeft);
-	
-	// Settings for the Bluetooth layer
-	text_layer_set_background_color(s_bt_dis_layer, GColorWhite);
-	text_layer_set_text_color(s_bt_dis_layer, GColorBlack);
-	text_layer_set_font(s_bt_dis_layer, fonts_get_system_font(FONT_KEY_ROBOTO_CONDENSED_21));
-	text_layer_set_text_alignment(s_bt_dis_layer, GTextAlignmentLeft);
-	text_layer_set_text(s_bt_dis_layer, "!B");  // Placeholder
-	
-	// Add it as a child layer to the Window's root layer
-	layer_add_child(window_layer, text_layer_get_layer(s_day_layer));
-	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
-	layer_add_child(window_layer, text_layer_get_layer(s_date_layer));
-	layer_add_child(window_layer, text_layer_get_layer(s_weather_layer));
-	layer_add_child(window_layer, text_layer_get_layer(s_temp_layer));
-	layer_add_child(window_layer, text_layer_get_layer(s_bt_dis_layer));
-	
-	// Add to battery bar layer to Window
-	layer_add_child(window_get_root_layer(window), s_battery_layer);
+	heap_trace_point(HEAP_LOAD_START);
+	HEAP_TRACE_CALL("display", display_load(window));
+	show_power_tier();
+	
+	// Restore the last weather report so it shows on the first frame
+	uint8_t packed[WEATHER_PACKED_SIZE];
+	int length = persist_read_data(PERSIST_KEY_WEATHER, packed, sizeof(packed));
+	if(length > 0) {
+		weather_unpack(packed, length, &s_weather);
+	}
+	show_weather();
 	
 	// Show the correct state of the BT connection from the start
+	bt_debounce_refresh();
 	bluetooth_callback(connection_service_peek_pebble_app_connection());
+	
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
 static void main_window_unload(Window *window) {
-	// Destroy TextLayer
-	text_layer_destroy(s_day_layer);
-	text_layer_destroy(s_time_layer);
-	text_layer_destroy(s_date_layer);
-	text_layer_destroy(s_weather_layer);
-	text_layer_destroy(s_temp_layer);
-	text_layer_destroy(s_bt_dis_layer);
-	
-	// Destroy the battery layer
-	layer_destroy(s_battery_layer);
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
+	display_unload();
+	heap_trace_point(HEAP_UNLOAD_END);
+}
+
+static bool is_night(struct tm *tick_time) {
+	int hour = tick_time->tm_hour;
+	if(SLEEP_START_HOUR <= SLEEP_END_HOUR) {
+		return hour >= SLEEP_START_HOUR && hour < SLEEP_END_HOUR;
+	}
+	// The window runs over midnight
+	return hour >= SLEEP_START_HOUR || hour < SLEEP_END_HOUR;
+}
+
+static bool should_sleep(struct tm *tick_time) {
+	if(s_seconds_mode) {
+		return false;
+	}
+	int still = time(NULL) - s_last_motion;
+	return still >= SLEEP_IDLE_TIME || (is_night(tick_time) && still >= SLEEP_WAKE_TIME);
+}
+
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
+
+// Second ticks in seconds mode, hourly while asleep, minute ticks otherwise
+static void subscribe_ticks() {
+	TimeUnits units = s_seconds_mode ? SECOND_UNIT : s_sleeping ? HOUR_UNIT : MINUTE_UNIT;
+	tick_timer_service_subscribe(units, tick_handler);
+}
+
+static void set_sleeping(bool sleeping) {
+	if(sleeping == s_sleeping) {
+		return;
+	}
+	s_sleeping = sleeping;
+	subscribe_ticks();
+	APP_LOG(APP_LOG_LEVEL_DEBUG, sleeping ? "Sleeping" : "Awake");
+}
+
+// The seconds take the place of the date while they show
+static void set_seconds_mode(bool on) {
+	if(on == s_seconds_mode) {
+		return;
+	}
+	time_t now = time(NULL);
+	s_seconds_mode = on;
+	s_seconds_mode_end = now + SECONDS_MODE_TIMEOUT;
+	
+	display_set_hidden(FIELD_DATE, on);
+	display_set_seconds(on ? localtime(&now)->tm_sec : -1);
+	subscribe_ticks();
+	APP_LOG(APP_LOG_LEVEL_INFO, on ? "Seconds mode on" : "Seconds mode off");
+}
+
+// Nothing but the seconds changes between minutes
+static void seconds_tick(struct tm *tick_time) {
+	bench_begin(BENCH_TICK_HANDLER);
+	telemetry_count(TELEMETRY_SECOND_TICKS);
+	display_set_seconds(tick_time->tm_sec);
+	bench_end(BENCH_TICK_HANDLER);
 }
 
 // start TickTimerService event service. struct tm contains the current time
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
-	update_time();
+	if(!(units_changed & MINUTE_UNIT)) {
+		seconds_tick(tick_time);
+		return;
+	}
+	
+	bench_begin(BENCH_TICK_HANDLER);
+	telemetry_tick(tick_time);
+	
+	update_time(tick_time);
+	if(s_seconds_mode) {
+		display_set_seconds(tick_time->tm_sec);
+		if(time(NULL) >= s_seconds_mode_end) {
+			set_seconds_mode(false);
+		}
+	}
+	
+	// Move the forecast strip on to the current point
+	if(s_forecast_timer && (units_changed & HOUR_UNIT)) {
+		show_forecast();
+	}
 	
-	// Get weather update every 30 minutes
-	if(tick_time->tm_min % 30 == 0) {
-		// Begin dictionary
-		DictionaryIterator *iter;
-		app_message_outbox_begin(&iter);
-		
-		// Add a key-value pair
-		dict_write_uint8(iter, 0,0);
-		
-		// Send the message!
-		app_message_outbox_send();
+	// Mark the weather once it goes out of date
+	if(s_weather.timestamp && weather_is_stale() != s_weather_stale) {
+		show_weather();
+	}
+	
+	// Get a weather update when one is due, unless asleep
+	set_sleeping(should_sleep(tick_time));
+	if(!s_sleeping) {
+		schedule_weather();
+	}
+	
+	bench_end(BENCH_TICK_HANDLER);
+}
+
+// Milliseconds on the clock time() reads, which the bench and trace replays
+// move, truncated to 32 bits. Only differences are used.
+static uint32_t tap_time_ms() {
+	uint16_t millis = time_ms(NULL, NULL);
+	return (uint32_t)time(NULL) * 1000 + millis;
+}
+
+// A wrist flick wakes the face and shows the current time straight away,
+// with the forecast for a moment. A double flick toggles seconds mode.
+static void accel_tap_handler(AccelAxisType axis, int32_t direction) {
+	uint32_t tap_ms = tap_time_ms();
+	bool double_tap = s_last_tap_ms && tap_ms - s_last_tap_ms < SECONDS_DOUBLE_TAP;
+	s_last_motion = time(NULL);
+	s_last_tap_ms = double_tap ? 0 : tap_ms;
+	
+	if(s_sleeping) {
+		tick_handler(localtime(&s_last_motion), DAY_UNIT | MINUTE_UNIT);
+	}
+	
+	// No forecast or seconds while the weather is off
+	if(s_power_tier == POWER_CRITICAL) {
+		return;
+	}
+	if(double_tap) {
+		set_seconds_mode(!s_seconds_mode);
+		if(s_forecast_timer) {
+			app_timer_cancel(s_forecast_timer);
+			hide_forecast(NULL);
+		}
+		return;
+	}
+	show_forecast();
+	if(!s_forecast_timer || !app_timer_reschedule(s_forecast_timer, FORECAST_SHOW_TIME)) {
+		s_forecast_timer = app_timer_register(FORECAST_SHOW_TIME, hide_forecast, NULL);
 	}
 }
 
 // setting up callback functions for AppMessage
 static void inbox_received_callback(DictionaryIterator *iterator, void *context) {
+	bench_begin(BENCH_INBOX_RECEIVED);
+	telemetry_inbox(iterator);
 	
-	// Store incoming information from javascript weather
-	static char temperature_buffer[8];
-	static char temp_layer_buffer[8];
+	// Read the weather from javascript, which only sends what changed
+	Tuple *weather_tuple = dict_find(iterator, KEY_WEATHER);
+	Tuple *time_tuple = dict_find(iterator, KEY_WEATHER_TIME);
+	Tuple *location_age_tuple = dict_find(iterator, KEY_LOCATION_AGE);
 	
-	static char conditions_buffer[32];
-	static char weather_layer_buffer[32];
-
-
-	// Read tuples for data
-	Tuple *temp_tuple = dict_find(iterator, KEY_TEMPERATURE);
-	Tuple *conditions_tuple = dict_find(iterator, KEY_CONDITIONS);
-
-	// If conditions data is available, use it
-	if(conditions_tuple) {
-	  snprintf(conditions_buffer, sizeof(conditions_buffer), "%s", conditions_tuple->value->cstring);
-	  
-  	  // Assemble full string and display
-  	  snprintf(weather_layer_buffer, sizeof(weather_layer_buffer), "%s", conditions_buffer);
-  	  text_layer_set_text(s_weather_layer, weather_layer_buffer);
+	if(location_age_tuple) {
+	  APP_LOG(APP_LOG_LEVEL_DEBUG, "Weather location is %d minutes old", (int)location_age_tuple->value->int32);
+	}
+	
+	// A full report replaces the cached one
+	if(weather_tuple && weather_unpack(weather_tuple->value->data, weather_tuple->length, &s_weather)) {
+	  save_weather();
+	  show_weather();
+	  weather_request_done();
+	}
+	// Otherwise the weather is unchanged and only its fetch time moves on
+	else if(time_tuple && s_weather.timestamp) {
+	  s_weather.timestamp = time_tuple->value->uint32;
+	  save_weather();
+	  show_weather();
+	  weather_request_done();
 	}
 	
-	// If temperature data is available, use it
-	if(temp_tuple) {
-	  snprintf(temperature_buffer, sizeof(temperature_buffer), "%d", (int)temp_tuple->value->int32);
-	  
-  	  // Assemble full string and display
-  	  snprintf(temp_layer_buffer, sizeof(temp_layer_buffer), "%s", temperature_buffer);
-  	  text_layer_set_text(s_temp_layer, temp_layer_buffer);
+	// The forecast arrives in chunks after the weather
+	Tuple *forecast_tuple = dict_find(iterator, KEY_FORECAST);
+	if(forecast_tuple && forecast_receive(forecast_tuple->value->data, forecast_tuple->length) &&
+			s_forecast_timer) {
+		show_forecast();
 	}
+	
+	// The phone asks a profiling build for its frame timings
+	if(dict_find(iterator, KEY_PROFILE)) {
+		profile_dump();
+	}
+	
+	bench_end(BENCH_INBOX_RECEIVED);
 }
 
 // set up three callbacks for error messages
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
 	APP_LOG(APP_LOG_LEVEL_ERROR, "Message dropped!");
+	// Only a dropped reply to our request needs a retry, a dropped push from
+	// the phone leaves the schedule alone
+	if(s_request_sent) {
+		weather_request_failed();
+	}
 }
 static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
 	APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox send failed");
+	telemetry_count(TELEMETRY_OUTBOX_FAILED);
+	outbox_failed();
 }
 static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
 	APP_LOG(APP_LOG_LEVEL_INFO, "Outbox send success!");
+	telemetry_count(TELEMETRY_OUTBOX_SENT);
+	outbox_sent();
+}
+
+// A queued message went out, or was dropped after retrying until it expired
+static void outbox_result(uint32_t key, bool sent) {
+	if(key == KEY_TELEMETRY) {
+		telemetry_upload_result(sent);
+	} else if(key == KEY_REQUEST && !sent) {
+		weather_request_failed();
+	}
+}
+
+#ifdef BENCHMARK
+// sample weather reply for the simulated day, the temperature follows the hour
+static void bench_write_weather(DictionaryIterator *iter, int minute) {
+	const WeatherCache weather = {
+		.temperature = minute / MINUTES_PER_HOUR - 5,
+		.condition = (minute / 30) % 2 ? CONDITION_CLOUDS : CONDITION_CLEAR,
+		.timestamp = time(NULL)
+	};
+	uint8_t packed[WEATHER_PACKED_SIZE];
+	weather_pack(&weather, packed);
+	dict_write_data(iter, KEY_WEATHER, packed, sizeof(packed));
 }
+#endif
 
 static void init() {
+	// Count from the start, everything below may report to telemetry
+	telemetry_init();
+	outbox_init(outbox_result);
+	forecast_init();
+	bt_debounce_init(show_bluetooth);
+	time_format_init(&s_time_format, ' ');
+	
 	// Create main Window element and assign to pointer
 	s_main_window = window_create();
 	
@@ -245,12 +654,19 @@ static void init() {
 		.unload = main_window_unload
 	});
 	
+	// Start in the right power tier, so a disconnect at launch respects it
+	set_power_tier(battery_state_service_peek());
+	
 	// Show the Window on the watch, with animated=true
 	window_stack_push(s_main_window, true);
 	
 	// Register with TickTimerService
 	tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
 	
+	// Wrist flicks keep the face out of sleep mode
+	s_last_motion = time(NULL);
+	accel_tap_service_subscribe(accel_tap_handler);
+	
 	// subscribe to updates for the battery level
 	battery_state_service_subscribe(battery_callback);
 	
@@ -258,7 +674,8 @@ static void init() {
 	battery_callback(battery_state_service_peek());
 	
 	// Make sure the time is displayed from the start
-	update_time();
+	time_t temp = time(NULL);
+	update_time(localtime(&temp));
 	
 	// Register for Bluetooth connection updates
 	connection_service_subscribe((ConnectionHandlers) {
@@ -271,16 +688,40 @@ static void init() {
 	app_message_register_outbox_failed(outbox_failed_callback);
 	app_message_register_outbox_sent(outbox_sent_callback);
 	
-	// Open AppMessage
-	const int inbox_size = 128;
-	const int outbox_size = 128;
+	// Open AppMessage with buffers sized for the largest message each way
+	const int inbox_size = MAX(dict_calc_buffer_size(2, WEATHER_PACKED_SIZE, sizeof(int32_t)),
+		dict_calc_buffer_size(1, FORECAST_CHUNK_SIZE));
+	const int outbox_size = dict_calc_buffer_size(1, TELEMETRY_UPLOAD_SIZE);
 	app_message_open(inbox_size, outbox_size);
+	
+	// PebbleKit JS sends the weather when it starts, so wait for that reply
+	// before scheduling a request of our own
+	s_connected = connection_service_peek_pebble_app_connection();
+	if(s_connected) {
+		s_request_sent = time(NULL);
+	}
+	
+#ifdef BENCHMARK
+	// Replay a simulated day through the callbacks
+	bench_run_day((BenchHandlers) {
+		.tick = tick_handler,
+		.battery = battery_callback,
+		.inbox = inbox_received_callback,
+		.tap = accel_tap_handler,
+		.connection = bluetooth_callback,
+		.write_weather = bench_write_weather
+	});
+#endif
 }
 
 static void deinit() {
 	// every create function should be paired with destroy
 	// Destroy Window
 	window_destroy(s_main_window);
+	
+	bt_debounce_deinit();
+	outbox_deinit();
+	telemetry_deinit();
 }
 
 int main(void) {
@@ -0,0 +1,204 @@
+#include "outbox.h"
+#include "bench.h"
+#include "event_trace.h"
+
+// messages waiting at once
+#define OUTBOX_QUEUE_SIZE 4
+
+// delay before retrying a failed send, doubling up to the maximum
+#define OUTBOX_RETRY_MIN_MS 2000
+#define OUTBOX_RETRY_MAX_MS (2 * 60 * 1000)
+
+typedef struct {
+	uint32_t key;
+	uint8_t *data;  // a byte array, or NULL to send value
+	uint16_t length;
+	uint8_t value;
+	time_t expires;
+} OutboxMessage;
+
+// oldest first, the head is the one being sent
+static OutboxMessage s_queue[OUTBOX_QUEUE_SIZE];
+static int s_count;
+static bool s_in_flight;
+
+static bool s_connected = true;
+static int s_retry_ms;  // current retry delay, 0 after a success
+static AppTimer *s_retry_timer;
+
+static OutboxResultHandler s_result_handler;
+
+static void flush(void);
+
+// Take a message off the queue and report what happened to it
+static void remove_message(int index, bool sent) {
+	uint32_t key = s_queue[index].key;
+	
+	free(s_queue[index].data);
+	memmove(&s_queue[index], &s_queue[index + 1], (s_count - index - 1) * sizeof(OutboxMessage));
+	s_count--;
+	
+	if(s_result_handler) {
+		s_result_handler(key, sent);
+	}
+}
+
+static void drop_expired() {
+	time_t now = time(NULL);
+	
+	for(int i = s_count - 1; i >= 0; i--) {
+		if(now >= s_queue[i].expires) {
+			APP_LOG(APP_LOG_LEVEL_WARNING, "Dropping message %lu, it expired", (unsigned long)s_queue[i].key);
+			remove_message(i, false);
+		}
+	}
+}
+
+static void retry_timer_callback(void *data) {
+	s_retry_timer = NULL;
+	flush();
+}
+
+static void schedule_retry() {
+	s_retry_ms = s_retry_ms ? MIN(s_retry_ms * 2, OUTBOX_RETRY_MAX_MS) : OUTBOX_RETRY_MIN_MS;
+	s_retry_timer = app_timer_register(s_retry_ms, retry_timer_callback, NULL);
+}
+
+// Send the head of the queue if nothing stands in the way
+static void flush() {
+	if(s_in_flight || !s_connected || s_retry_timer) {
+		return;
+	}
+	
+	drop_expired();
+	if(s_count == 0) {
+		return;
+	}
+	
+	// The outbox may still be busy with a message sent outside the queue
+	DictionaryIterator *iter;
+	if(app_message_outbox_begin(&iter) != APP_MSG_OK) {
+		schedule_retry();
+		return;
+	}
+	
+	OutboxMessage *message = &s_queue[0];
+	if(message->data) {
+		dict_write_data(iter, message->key, message->data, message->length);
+	} else {
+		dict_write_uint8(iter, message->key, message->value);
+	}
+	
+	if(app_message_outbox_send() != APP_MSG_OK) {
+		schedule_retry();
+		return;
+	}
+	s_in_flight = true;
+}
+
+// Replace a message with the same key that is still waiting, or add one
+static bool queue(uint32_t key, const uint8_t *data, uint16_t length, uint8_t value, int ttl) {
+	uint8_t *copy = NULL;
+	if(data) {
+		copy = malloc(length);
+		if(!copy) {
+			return false;
+		}
+		memcpy(copy, data, length);
+	}
+	
+	OutboxMessage *message = NULL;
+	for(int i = s_in_flight ? 1 : 0; i < s_count; i++) {
+		if(s_queue[i].key == key) {
+			message = &s_queue[i];
+			free(message->data);
+			break;
+		}
+	}
+	
+	if(!message) {
+		if(s_count == OUTBOX_QUEUE_SIZE) {
+			APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox queue full, not sending %lu", (unsigned long)key);
+			free(copy);
+			return false;
+		}
+		message = &s_queue[s_count++];
+	}
+	
+	*message = (OutboxMessage) {
+		.key = key,
+		.data = copy,
+		.length = length,
+		.value = value,
+		.expires = time(NULL) + ttl
+	};
+	flush();
+	return true;
+}
+
+void outbox_init(OutboxResultHandler handler) {
+	s_result_handler = handler;
+}
+
+void outbox_deinit() {
+	if(s_retry_timer) {
+		app_timer_cancel(s_retry_timer);
+		s_retry_timer = NULL;
+	}
+	s_in_flight = false;
+	s_retry_ms = 0;
+	
+	for(int i = 0; i < s_count; i++) {
+		free(s_queue[i].data);
+	}
+	s_count = 0;
+}
+
+bool outbox_send_uint8(uint32_t key, uint8_t value, int ttl) {
+	return queue(key, NULL, 0, value, ttl);
+}
+
+bool outbox_send_data(uint32_t key, const uint8_t *data, uint16_t length, int ttl) {
+	return queue(key, data, length, 0, ttl);
+}
+
+void outbox_sent() {
+	if(!s_in_flight) {
+		return;
+	}
+	s_in_flight = false;
+	s_retry_ms = 0;
+	remove_message(0, true);
+	flush();
+}
+
+// The message stays at the head until it goes out or expires
+void outbox_failed() {
+	if(!s_in_flight) {
+		return;
+	}
+	s_in_flight = false;
+	
+	// Nothing left worth retrying for
+	drop_expired();
+	if(s_count == 0) {
+		return;
+	}
+	schedule_retry();
+	APP_LOG(APP_LOG_LEVEL_WARNING, "Retrying message %lu in %dms", (unsigned long)s_queue[0].key, s_retry_ms);
+}
+
+void outbox_set_connected(bool connected) {
+	bool reconnected = connected && !s_connected;
+	s_connected = connected;
+	
+	// Skip the rest of the backoff
+	if(reconnected) {
+		if(s_retry_timer) {
+			app_timer_cancel(s_retry_timer);
+			s_retry_timer = NULL;
+		}
+		s_retry_ms = 0;
+		flush();
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <pebble.h>
+
+// Queue of messages for the phone, one tuple each. Messages wait while the
+// phone is away or the outbox is busy, failed sends are retried with
+// backoff, and a message that has not gone out within its time to live is
+// dropped. Queueing a key that is already waiting replaces the waiting
+// message, so repeated requests go out once.
+
+// Called once a message leaves the queue, sent or dropped
+typedef void (*OutboxResultHandler)(uint32_t key, bool sent);
+
+void outbox_init(OutboxResultHandler handler);
+void outbox_deinit(void);
+
+// Queue a message that may wait ttl seconds, false if the queue is full
+bool outbox_send_uint8(uint32_t key, uint8_t value, int ttl);
+bool outbox_send_data(uint32_t key, const uint8_t *data, uint16_t length, int ttl);
+
+// Call from the AppMessage outbox callbacks
+void outbox_sent(void);
+void outbox_failed(void);
+
+// Waiting messages go out as soon as the phone is back
+void outbox_set_connected(bool connected);
@@ -0,0 +1,209 @@
+#include "profile.h"
+#include "bench.h"
+#include "event_trace.h"
+#include "heap_trace.h"
+#include "outbox.h"
+
+#ifdef PROFILER
+
+// draw times are kept as a histogram of whole milliseconds, the last
+// bucket also holds everything slower
+#define PROFILE_BUCKETS 32
+
+#define PROFILE_LOG_MINUTES 15
+
+// how long a dump may wait in the outbox queue
+#define PROFILE_DUMP_TTL 60
+
+typedef struct {
+	uint32_t count;
+	uint32_t total_ms;
+	uint16_t min_ms;
+	uint16_t max_ms;
+	uint16_t histogram[PROFILE_BUCKETS];
+} ProfileStats;
+
+static const char *s_element_names[PROFILE_ELEMENT_COUNT] = {
+	"day", "time", "date", "conditions", "temperature",
+	"forecast", "bluetooth", "battery", "frame"
+};
+
+static ProfileStats s_stats[PROFILE_ELEMENT_COUNT];
+
+// the element being timed, -1 for none
+static int s_current = -1;
+static uint32_t s_current_start;
+static uint32_t s_frame_start;
+
+// frames per minute
+static time_t s_minute;
+static uint16_t s_minute_frames;
+static uint16_t s_last_minute_frames;
+static uint16_t s_max_minute_frames;
+static int s_minutes;
+
+typedef struct {
+	int element;
+	Layer *target;
+} ProfileProbe;
+
+static Layer *s_probes[PROFILE_ELEMENT_COUNT];
+
+// milliseconds since the epoch, truncated to 32 bits. Only differences are used.
+static uint32_t now_ms() {
+	time_t seconds;
+	uint16_t millis;
+	time_ms(&seconds, &millis);
+	return (uint32_t)seconds * 1000 + millis;
+}
+
+static void record(int element, uint32_t elapsed) {
+	ProfileStats *stats = &s_stats[element];
+	
+	if(stats->count == 0 || elapsed < stats->min_ms) {
+		stats->min_ms = elapsed;
+	}
+	if(elapsed > stats->max_ms) {
+		stats->max_ms = elapsed;
+	}
+	stats->count++;
+	stats->total_ms += elapsed;
+	
+	// The counts halve when one would overflow, keeping the shape
+	int bucket = MIN(elapsed, PROFILE_BUCKETS - 1);
+	if(stats->histogram[bucket] == UINT16_MAX) {
+		for(int i = 0; i < PROFILE_BUCKETS; i++) {
+			stats->histogram[i] /= 2;
+		}
+	}
+	stats->histogram[bucket]++;
+}
+
+static int percentile_ms(const ProfileStats *stats, int percent) {
+	uint32_t total = 0;
+	for(int i = 0; i < PROFILE_BUCKETS; i++) {
+		total += stats->histogram[i];
+	}
+	
+	uint32_t seen = 0;
+	for(int i = 0; i < PROFILE_BUCKETS; i++) {
+		seen += stats->histogram[i];
+		if(seen * 100 >= total * percent) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+static int mean_tenths_ms(const ProfileStats *stats) {
+	return stats->count ? (int)((uint64_t)stats->total_ms * 10 / stats->count) : 0;
+}
+
+void profile_start(int element) {
+	uint32_t now = now_ms();
+	
+	if(s_current >= 0) {
+		record(s_current, now - s_current_start);
+	}
+	s_current = element;
+	s_current_start = now;
+}
+
+void profile_stop() {
+	if(s_current >= 0) {
+		record(s_current, now_ms() - s_current_start);
+	}
+	s_current = -1;
+}
+
+void profile_frame_begin() {
+	s_frame_start = now_ms();
+}
+
+void profile_frame_end() {
+	profile_stop();
+	record(PROFILE_FRAME, now_ms() - s_frame_start);
+	
+	// Close the minute once a frame falls into the next one
+	time_t minute = time(NULL) / SECONDS_PER_MINUTE;
+	if(minute != s_minute) {
+		if(s_minute) {
+			s_last_minute_frames = s_minute_frames;
+			s_max_minute_frames = MAX(s_max_minute_frames, s_minute_frames);
+			if(++s_minutes % PROFILE_LOG_MINUTES == 0) {
+				profile_log();
+			}
+		}
+		s_minute = minute;
+		s_minute_frames = 0;
+	}
+	s_minute_frames++;
+}
+
+static void probe_update_proc(Layer *layer, GContext *ctx) {
+	ProfileProbe *probe = layer_get_data(layer);
+	if(layer_get_hidden(probe->target)) {
+		profile_stop();
+	} else {
+		profile_start(probe->element);
+	}
+}
+
+void profile_add_probe(Layer *parent, int element, Layer *target) {
+	Layer *probe = HEAP_TRACE_OBJECT("profile probe", layer_create_with_data(GRectZero, sizeof(ProfileProbe)));
+	*(ProfileProbe *)layer_get_data(probe) = (ProfileProbe) { .element = element, .target = target };
+	layer_set_update_proc(probe, probe_update_proc);
+	layer_add_child(parent, probe);
+	s_probes[element] = probe;
+}
+
+void profile_remove_probes() {
+	for(int i = 0; i < PROFILE_ELEMENT_COUNT; i++) {
+		layer_destroy(s_probes[i]);
+		s_probes[i] = NULL;
+	}
+}
+
+void profile_log() {
+	APP_LOG(APP_LOG_LEVEL_INFO, "profile frames: last minute=%d busiest minute=%d",
+		s_last_minute_frames, s_max_minute_frames);
+	
+	for(int i = 0; i < PROFILE_ELEMENT_COUNT; i++) {
+		const ProfileStats *stats = &s_stats[i];
+		int mean = mean_tenths_ms(stats);
+		APP_LOG(APP_LOG_LEVEL_INFO, "profile %s: draws=%lu min=%dms mean=%d.%dms p95=%dms max=%dms",
+			s_element_names[i], (unsigned long)stats->count, stats->min_ms, mean / 10, mean % 10,
+			percentile_ms(stats, 95), stats->max_ms);
+	}
+}
+
+static uint8_t *put16(uint8_t *data, uint16_t value) {
+	data[0] = value;
+	data[1] = value >> 8;
+	return data + 2;
+}
+
+void profile_dump() {
+	uint8_t buffer[PROFILE_DUMP_SIZE];
+	uint8_t *data = buffer;
+	
+	*data++ = PROFILE_FORMAT_VERSION;
+	*data++ = PROFILE_ELEMENT_COUNT;
+	data = put16(data, s_last_minute_frames);
+	data = put16(data, s_max_minute_frames);
+	
+	for(int i = 0; i < PROFILE_ELEMENT_COUNT; i++) {
+		const ProfileStats *stats = &s_stats[i];
+		data = put16(data, stats->count);
+		data = put16(data, stats->count >> 16);
+		data = put16(data, stats->min_ms);
+		data = put16(data, MIN(mean_tenths_ms(stats), UINT16_MAX));
+		data = put16(data, percentile_ms(stats, 95));
+		data = put16(data, stats->max_ms);
+	}
+	
+	profile_log();
+	outbox_send_data(KEY_PROFILE, buffer, sizeof(buffer), PROFILE_DUMP_TTL);
+}
+
+#endif
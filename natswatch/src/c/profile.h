@@ -0,0 +1,61 @@
+#pragma once
+#include <pebble.h>
+#include "display.h"
+
+// Uncomment to time each element of every frame, keeping its min, mean,
+// p95 and max draw time and the frames drawn per minute. The summary is
+// logged every PROFILE_LOG_MINUTES and sent to the phone when it asks.
+// #define PROFILER
+
+#define KEY_PROFILE 7  // dump request from the phone, and the summary sent back
+
+// Elements of a frame that are timed, starting with one per DisplayField
+typedef enum {
+	PROFILE_FORECAST = FIELD_COUNT,
+	PROFILE_BLUETOOTH,
+	PROFILE_BATTERY,
+	PROFILE_FRAME,  // the whole frame
+	PROFILE_ELEMENT_COUNT
+} ProfileElement;
+
+// Summary for the phone, one byte array tuple, numbers little endian:
+// [0] format version, [1] number of elements, [2..3] frames drawn in the
+// last full minute, [4..5] most frames drawn in a minute, then per element
+// the number of draws as uint32, and min ms, mean in tenths of a ms, p95 ms
+// and max ms as uint16
+#define PROFILE_FORMAT_VERSION 1
+#define PROFILE_PACKED_ELEMENT 12
+#define PROFILE_DUMP_SIZE (6 + PROFILE_ELEMENT_COUNT * PROFILE_PACKED_ELEMENT)
+
+#ifdef PROFILER
+
+// Time an element until the next profile_start or profile_stop
+void profile_start(int element);
+void profile_stop(void);
+
+void profile_frame_begin(void);
+void profile_frame_end(void);
+
+// Layers that draw themselves are timed by an empty layer added in front
+// of them, which starts timing element when it is drawn. Add it just
+// before target, the element is not timed while target is hidden.
+void profile_add_probe(Layer *parent, int element, Layer *target);
+void profile_remove_probes(void);
+
+void profile_log(void);
+
+// Send the summary to the phone
+void profile_dump(void);
+
+#else
+
+#define profile_start(element)
+#define profile_stop()
+#define profile_frame_begin()
+#define profile_frame_end()
+#define profile_add_probe(parent, element, target)
+#define profile_remove_probes()
+#define profile_log()
+#define profile_dump()
+
+#endif
@@ -0,0 +1,211 @@
+#include "telemetry.h"
+#include "bench.h"
+#include "event_trace.h"
+#include "outbox.h"
+
+// persistent storage keys, natswatch.c keeps to keys below 10
+#define PERSIST_KEY_TELEMETRY_TODAY 10
+#define PERSIST_KEY_TELEMETRY_HEAD 11  // next ring slot to write
+#define PERSIST_KEY_TELEMETRY_RING 20  // first of TELEMETRY_DAYS slots
+
+#define CHARGE_UNKNOWN 0xFF
+
+// an upload waits in the outbox queue up to the next hourly retry
+#define TELEMETRY_UPLOAD_TTL SECONDS_PER_HOUR
+
+typedef struct {
+	uint32_t date;  // YYYYMMDD, 0 for an empty slot
+	uint16_t counts[TELEMETRY_COUNTER_COUNT];
+	uint32_t inbox_bytes;
+	uint32_t render_ms;
+	uint32_t charging_hours;
+	uint8_t charge[HOURS_PER_DAY];
+	bool uploaded;
+} TelemetryDay;
+
+static TelemetryDay s_today;
+static BatteryChargeState s_charge;
+static uint32_t s_frame_start_ms;
+
+static bool s_upload_pending;  // there may be finished days the phone has not got
+static uint8_t s_uploading;  // bit per ring slot in the queued message
+
+// milliseconds since the epoch, truncated to 32 bits. Only differences are used.
+static uint32_t now_ms() {
+	time_t seconds;
+	uint16_t millis;
+	time_ms(&seconds, &millis);
+	return (uint32_t)seconds * 1000 + millis;
+}
+
+static uint32_t date_of(struct tm *tick_time) {
+	return (tick_time->tm_year + 1900) * 10000 + (tick_time->tm_mon + 1) * 100 + tick_time->tm_mday;
+}
+
+static void start_day(uint32_t date) {
+	memset(&s_today, 0, sizeof(s_today));
+	memset(s_today.charge, CHARGE_UNKNOWN, sizeof(s_today.charge));
+	s_today.date = date;
+}
+
+static void save_today() {
+	persist_write_data(PERSIST_KEY_TELEMETRY_TODAY, &s_today, sizeof(s_today));
+}
+
+// Move today into the ring
+static void finish_day() {
+	int head = persist_read_int(PERSIST_KEY_TELEMETRY_HEAD) % TELEMETRY_DAYS;
+	persist_write_data(PERSIST_KEY_TELEMETRY_RING + head, &s_today, sizeof(s_today));
+	persist_write_int(PERSIST_KEY_TELEMETRY_HEAD, (head + 1) % TELEMETRY_DAYS);
+	s_upload_pending = true;
+}
+
+static uint8_t *put16(uint8_t *data, uint16_t value) {
+	data[0] = value;
+	data[1] = value >> 8;
+	return data + 2;
+}
+
+static uint8_t *put32(uint8_t *data, uint32_t value) {
+	data = put16(data, value);
+	return put16(data, value >> 16);
+}
+
+static uint8_t *pack_day(const TelemetryDay *day, uint8_t *data) {
+	data = put32(data, day->date);
+	for(int i = 0; i < TELEMETRY_COUNTER_COUNT; i++) {
+		data = put16(data, day->counts[i]);
+	}
+	data = put32(data, day->inbox_bytes);
+	data = put32(data, day->render_ms);
+	data = put32(data, day->charging_hours);
+	memcpy(data, day->charge, HOURS_PER_DAY);
+	return data + HOURS_PER_DAY;
+}
+
+// Send every finished day the phone has not acknowledged in one message
+static void upload() {
+	static uint8_t buffer[TELEMETRY_UPLOAD_SIZE];
+	uint8_t *data = buffer + 2;
+	uint8_t slots = 0;
+	int days = 0;
+	
+	if(s_uploading) {
+		return;
+	}
+	
+	for(int i = 0; i < TELEMETRY_DAYS; i++) {
+		TelemetryDay day;
+		if(persist_read_data(PERSIST_KEY_TELEMETRY_RING + i, &day, sizeof(day)) == sizeof(day) &&
+				day.date && !day.uploaded) {
+			data = pack_day(&day, data);
+			slots |= 1 << i;
+			days++;
+		}
+	}
+	
+	if(days == 0) {
+		s_upload_pending = false;
+		return;
+	}
+	buffer[0] = TELEMETRY_FORMAT_VERSION;
+	buffer[1] = days;
+	
+	// Try again next hour if the queue is full
+	if(outbox_send_data(KEY_TELEMETRY, buffer, data - buffer, TELEMETRY_UPLOAD_TTL)) {
+		s_uploading = slots;
+	}
+}
+
+static void mark_uploaded(uint8_t slots) {
+	for(int i = 0; i < TELEMETRY_DAYS; i++) {
+		TelemetryDay day;
+		if((slots & 1 << i) &&
+				persist_read_data(PERSIST_KEY_TELEMETRY_RING + i, &day, sizeof(day)) == sizeof(day)) {
+			day.uploaded = true;
+			persist_write_data(PERSIST_KEY_TELEMETRY_RING + i, &day, sizeof(day));
+		}
+	}
+}
+
+// Note the charge for the hour, and whether it was charging at any point
+static void record_charge(struct tm *tick_time) {
+	s_today.charge[tick_time->tm_hour] = s_charge.charge_percent;
+	if(s_charge.is_charging) {
+		s_today.charging_hours |= 1 << tick_time->tm_hour;
+	}
+}
+
+void telemetry_init() {
+	time_t now = time(NULL);
+	struct tm *tick_time = localtime(&now);
+	
+	s_charge = battery_state_service_peek();
+	if(persist_read_data(PERSIST_KEY_TELEMETRY_TODAY, &s_today, sizeof(s_today)) != sizeof(s_today)) {
+		start_day(date_of(tick_time));
+	}
+	
+	// Days that ended while the face was not running go out on the first tick
+	s_upload_pending = true;
+}
+
+void telemetry_deinit() {
+	save_today();
+}
+
+// A day of seconds mode would wrap a count, so counts stop at the top
+void telemetry_count(TelemetryCounter counter) {
+	if(s_today.counts[counter] < UINT16_MAX) {
+		s_today.counts[counter]++;
+	}
+}
+
+void telemetry_inbox(DictionaryIterator *iterator) {
+	s_today.counts[TELEMETRY_INBOX_MESSAGES]++;
+	s_today.inbox_bytes += dict_size(iterator);
+}
+
+void telemetry_battery(BatteryChargeState state) {
+	time_t now = time(NULL);
+	
+	s_charge = state;
+	record_charge(localtime(&now));
+}
+
+void telemetry_frame_begin() {
+	s_frame_start_ms = now_ms();
+}
+
+void telemetry_frame_end() {
+	s_today.render_ms += now_ms() - s_frame_start_ms;
+}
+
+void telemetry_tick(struct tm *tick_time) {
+	uint32_t date = date_of(tick_time);
+	bool new_day = date != s_today.date;
+	
+	if(new_day) {
+		finish_day();
+		start_day(date);
+	}
+	
+	s_today.counts[TELEMETRY_TICKS]++;
+	record_charge(tick_time);
+	
+	// Keep the counts hourly in case the face is killed without deinit,
+	// and retry a failed upload no more than hourly
+	if(new_day || tick_time->tm_min == 0) {
+		save_today();
+		if(s_upload_pending) {
+			upload();
+		}
+	}
+}
+
+void telemetry_upload_result(bool sent) {
+	if(sent) {
+		mark_uploaded(s_uploading);
+		s_upload_pending = false;
+	}
+	s_uploading = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <pebble.h>
+
+#define KEY_TELEMETRY 5  // batch of daily telemetry records for the phone
+
+// what is counted each day
+typedef enum {
+	TELEMETRY_TICKS,
+	TELEMETRY_OUTBOX_SENT,
+	TELEMETRY_OUTBOX_FAILED,
+	TELEMETRY_INBOX_MESSAGES,
+	TELEMETRY_VIBES,
+	TELEMETRY_BT_FLIPS,
+	TELEMETRY_SECOND_TICKS,  // seconds mode ticks, not counted in TELEMETRY_TICKS
+	TELEMETRY_COUNTER_COUNT
+} TelemetryCounter;
+
+// finished days kept until they reach the phone, the oldest is overwritten
+#define TELEMETRY_DAYS 7
+
+#define HOURS_PER_DAY 24
+
+// Upload format, one byte array tuple, numbers little endian:
+// [0] format version, [1] number of days, then per day:
+// date as YYYYMMDD uint32, a uint16 per TelemetryCounter that stops at
+// 65535, inbox bytes, ms spent drawing, a bit per hour spent charging as
+// uint32, and the charge percent at the end of each hour, 0xFF if unknown
+#define TELEMETRY_FORMAT_VERSION 2
+#define TELEMETRY_PACKED_DAY (4 + 2 * TELEMETRY_COUNTER_COUNT + 3 * 4 + HOURS_PER_DAY)
+#define TELEMETRY_UPLOAD_SIZE (2 + TELEMETRY_DAYS * TELEMETRY_PACKED_DAY)
+
+// Restore today's counts on launch and keep them on exit
+void telemetry_init(void);
+void telemetry_deinit(void);
+
+void telemetry_count(TelemetryCounter counter);
+void telemetry_inbox(DictionaryIterator *iterator);
+void telemetry_battery(BatteryChargeState state);
+
+// Time spent drawing a frame
+void telemetry_frame_begin(void);
+void telemetry_frame_end(void);
+
+// Call from the tick handler, this also starts new days and uploads old ones
+void telemetry_tick(struct tm *tick_time);
+
+// Call when the upload left the outbox queue, sent or dropped
+void telemetry_upload_result(bool sent);
+
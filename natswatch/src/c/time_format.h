@@ -0,0 +1,55 @@
+#pragma once
+#include <pebble.h>
+
+// Languages for day and month names. Only the tables of the language
+// picked here are built in, so adding languages costs no code size.
+#define TIME_FORMAT_EN 0
+#define TIME_FORMAT_DE 1
+#define TIME_FORMAT_FR 2
+#define TIME_FORMAT_ES 3
+
+#define TIME_FORMAT_LANGUAGE TIME_FORMAT_EN
+
+// Longest name in each table plus its terminator, in UTF-8 bytes
+#if TIME_FORMAT_LANGUAGE == TIME_FORMAT_DE
+#define TIME_FORMAT_DAY_SIZE 11  // "Donnerstag"
+#define TIME_FORMAT_MONTH_SIZE 10  // "September"
+#elif TIME_FORMAT_LANGUAGE == TIME_FORMAT_FR
+#define TIME_FORMAT_DAY_SIZE 9  // "mercredi"
+#define TIME_FORMAT_MONTH_SIZE 10  // "septembre"
+#elif TIME_FORMAT_LANGUAGE == TIME_FORMAT_ES
+#define TIME_FORMAT_DAY_SIZE 11  // "miércoles"
+#define TIME_FORMAT_MONTH_SIZE 11  // "septiembre"
+#else
+#define TIME_FORMAT_DAY_SIZE 10  // "Wednesday"
+#define TIME_FORMAT_MONTH_SIZE 10  // "September"
+#endif
+
+// "23:59"
+#define TIME_FORMAT_TIME_SIZE 6
+
+// the month, a space and the day of the month, as "%B %e"
+#define TIME_FORMAT_DATE_SIZE (TIME_FORMAT_MONTH_SIZE + 3)
+
+// fields time_format_update rewrote
+#define TIME_FORMAT_TIME 1
+#define TIME_FORMAT_DAY 2
+#define TIME_FORMAT_DATE 4
+
+// Text for the time fields, kept until the tm members behind them change
+typedef struct {
+	char time[TIME_FORMAT_TIME_SIZE];
+	char day[TIME_FORMAT_DAY_SIZE];
+	char date[TIME_FORMAT_DATE_SIZE];
+	char pad;  // fills the tens of a 12 hour time before 10
+	int minute;  // minute of the day in time, -1 before the first update
+	int day_number;  // year and day of the year in day and date
+} TimeFormatter;
+
+// Read the 12/24 hour setting once, it cannot change while the face runs.
+// pad is '0' for "%I:%M" or ' ' for "%l:%M" in 12 hour time.
+void time_format_init(TimeFormatter *formatter, char pad);
+
+// Reformat the fields whose tm members changed since the last update,
+// returns the TIME_FORMAT_ fields that were rewritten
+int time_format_update(TimeFormatter *formatter, const struct tm *tick_time);
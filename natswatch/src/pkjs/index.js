@@ -2,68 +2,435 @@
 var shared = require('../../app-env');
 var specialKey = shared.test();
 
-var xhrRequest = function (url, type, callback) {
-	var xhr = new XMLHttpRequest();
-	xhr.onload = function () {
-		callback(this.responseText);
+var locator = require('./location');
+var telemetry = require('./telemetry');
+var profile = require('./profile');
+
+// Packed weather report format understood by the watch
+var WEATHER_FORMAT_VERSION = 1;
+
+// Forecast chunks, see forecast.h for the layout. The watch keeps
+// FORECAST_POINTS points, each FORECAST_STEP apart, and each chunk carries
+// at most FORECAST_CHUNK_POINTS so it fits the watch's small inbox.
+var FORECAST_FORMAT_VERSION = 1;
+var FORECAST_POINTS = 8;
+var FORECAST_CHUNK_POINTS = 4;
+
+// Flags the watch sets in KEY_REQUEST
+var REQUEST_FULL_REPORT = 1;
+var REQUEST_FORECAST = 2;
+
+// Condition codes sent to the watch, the index matches WeatherCondition in C
+var CONDITIONS = ['', 'Thunderstorm', 'Drizzle', 'Rain', 'Snow', 'Clear', 'Clouds', 'Mist',
+	'Smoke', 'Haze', 'Dust', 'Fog', 'Sand', 'Ash', 'Squall', 'Tornado'];
+
+// Reuse a weather response for the same area for this long. Keep it below
+// the watch's refresh interval, or the watch will keep asking for new data.
+var WEATHER_CACHE_TTL = 20 * 60 * 1000;
+var WEATHER_CACHE_KEY = 'weatherCache';
+
+// The forecast is in 3 hour steps, so it changes less often
+var FORECAST_CACHE_TTL = 3 * 60 * 60 * 1000;
+var FORECAST_CACHE_KEY = 'forecastCache';
+
+// Round coordinates to 2 decimal places (about 1 km) for the cache key
+var CACHE_PRECISION = 2;
+
+// Give up on a request after this long, and retry it this many times
+var XHR_TIMEOUT = 10000;
+var XHR_RETRIES = 2;
+
+var xhrRequest = function (url, type, callback, errorCallback) {
+	var attempts = 0;
+	
+	var retry = function (reason) {
+		console.log('Request failed: ' + reason);
+		if (attempts <= XHR_RETRIES) {
+			setTimeout(send, 1000 * attempts);
+		} else {
+			errorCallback(reason);
+		}
+	};
+	
+	var send = function () {
+		attempts++;
+		var xhr = new XMLHttpRequest();
+		xhr.timeout = XHR_TIMEOUT;
+		xhr.onload = function () {
+			if (this.status >= 500) {
+				retry('HTTP ' + this.status);
+			} else if (this.status !== 200) {
+				errorCallback('HTTP ' + this.status);
+			} else {
+				callback(this.responseText);
+			}
+		};
+		xhr.ontimeout = function () {
+			retry('timeout');
+		};
+		xhr.onerror = function () {
+			retry('network error');
+		};
+		xhr.open(type, url);
+		xhr.send();
 	};
-	xhr.open(type, url);
-	xhr.send();
+	
+	send();
 };
 
+function conditionCode(conditions) {
+	return Math.max(0, CONDITIONS.indexOf(conditions));
+}
+
+function packTemperature(temperature) {
+	return Math.max(-128, Math.min(127, temperature)) & 0xFF;
+}
+
+function packTime(timestamp) {
+	return [
+		timestamp & 0xFF,
+		(timestamp >> 8) & 0xFF,
+		(timestamp >> 16) & 0xFF,
+		(timestamp >>> 24) & 0xFF
+	];
+}
+
+// Pack a weather report into the byte array the watch expects:
+// version, condition code, temperature as int8, fetch time as uint32 little endian
+function packWeather(temperature, conditions, timestamp) {
+	return [
+		WEATHER_FORMAT_VERSION,
+		conditionCode(conditions),
+		packTemperature(temperature)
+	].concat(packTime(timestamp));
+}
+
+// Split a forecast into the chunks the watch reassembles: version, sequence
+// number, last chunk flag, time of the first point, then the points
+function packForecastChunks(forecast) {
+	var chunks = [];
+	var points = forecast.points.slice(0, FORECAST_POINTS);
+	
+	for (var i = 0; i < points.length; i += FORECAST_CHUNK_POINTS) {
+		var last = i + FORECAST_CHUNK_POINTS >= points.length;
+		var chunk = [FORECAST_FORMAT_VERSION, chunks.length, last ? 1 : 0].concat(packTime(forecast.start));
+		points.slice(i, i + FORECAST_CHUNK_POINTS).forEach(function (point) {
+			chunk.push(packTemperature(point.temperature), conditionCode(point.conditions));
+		});
+		chunks.push(chunk);
+	}
+	return chunks;
+}
+
+// Last report the watch acknowledged, so unchanged weather is not sent again
+var LAST_SENT_KEY = 'lastSent';
+
+function readLastSent() {
+	try {
+		return JSON.parse(localStorage.getItem(LAST_SENT_KEY));
+	} catch (e) {
+		return null;
+	}
+}
+
+// Make the next send a full report, for a watch that may have lost its copy
+function forgetLastSent() {
+	localStorage.removeItem(LAST_SENT_KEY);
+}
+
+function cacheKey(loc) {
+	return loc.latitude.toFixed(CACHE_PRECISION) + ',' + loc.longitude.toFixed(CACHE_PRECISION);
+}
+
+// Return a cached lookup for this area if it is recent enough
+function readCache(name, key, ttl) {
+	try {
+		var cached = JSON.parse(localStorage.getItem(name));
+		if (cached && cached.key === key && Date.now() - cached.time < ttl) {
+			return cached;
+		}
+	} catch (e) {
+		console.log('Ignoring unreadable ' + name);
+	}
+	return null;
+}
+
+// Temperature and conditions of a current weather response or forecast
+// entry, null when either is missing
+function readReport(entry) {
+	if (!entry || !entry.main || typeof entry.main.temp !== 'number' ||
+			!entry.weather || !entry.weather[0] || !entry.weather[0].main) {
+		return null;
+	}
+	return {
+		// Temperature in Kelvin requires adjustment
+		temperature: Math.round(entry.main.temp - 273.15),
+		conditions: entry.weather[0].main
+	};
+}
 
-function locationSuccess(pos) { 
+// Look up the weather at a location, from the cache when possible
+function fetchWeather(loc, callback) {
+	var key = cacheKey(loc);
+	var cached = readCache(WEATHER_CACHE_KEY, key, WEATHER_CACHE_TTL);
+	if (cached) {
+		console.log('Using cached weather from ' + new Date(cached.time));
+		callback(cached);
+		return;
+	}
+	
 	// Construct URL
-	var url = 'http://api.openweathermap.org/data/2.5/weather?lat=' + pos.coords.latitude + '&lon=' + pos.coords.longitude + '&appid=' + specialKey;
+	var url = 'http://api.openweathermap.org/data/2.5/weather?lat=' + loc.latitude + '&lon=' + loc.longitude + '&appid=' + specialKey;
 	
 	// Send request to OpenWeatherMap
 	xhrRequest(url, 'GET', 
 		function(responseText) {
 			// responseText contains a JSON object with weather info
-			var json = JSON.parse(responseText);
+			var json;
+			try {
+				json = JSON.parse(responseText);
+			} catch (e) {
+				console.log('Unreadable weather response');
+				callback(null);
+				return;
+			}
+			var report = readReport(json);
+			if (!report) {
+				console.log('Weather response has no temperature or conditions');
+				callback(null);
+				return;
+			}
 			
-			// Temperature in Kelvin requires adjustment
-			var temperature = Math.round(json.main.temp - 273.15);
-			console.log('Temperature is ' + temperature);
+			var weather = {
+				key: key,
+				time: Date.now(),
+				temperature: report.temperature,
+				conditions: report.conditions
+			};
+			console.log('Temperature is ' + weather.temperature);
+			console.log('Conditions are ' + weather.conditions);
 			
-			// Conditions
-			var conditions = json.weather[0].main;
-			console.log('Conditions are ' + conditions);
+			localStorage.setItem(WEATHER_CACHE_KEY, JSON.stringify(weather));
+			callback(weather);
+		},
+		function(reason) {
+			console.log('Giving up on weather request: ' + reason);
+			callback(null);
+		}
+	);
+}
+
+// Look up the forecast for the next FORECAST_POINTS steps, from the cache
+// when possible
+function fetchForecast(loc, callback) {
+	var key = cacheKey(loc);
+	var cached = readCache(FORECAST_CACHE_KEY, key, FORECAST_CACHE_TTL);
+	if (cached) {
+		console.log('Using cached forecast from ' + new Date(cached.time));
+		callback(cached);
+		return;
+	}
+	
+	var url = 'http://api.openweathermap.org/data/2.5/forecast?lat=' + loc.latitude + '&lon=' + loc.longitude +
+		'&cnt=' + FORECAST_POINTS + '&appid=' + specialKey;
+	
+	xhrRequest(url, 'GET',
+		function(responseText) {
+			var json;
+			try {
+				json = JSON.parse(responseText);
+			} catch (e) {
+				console.log('Unreadable forecast response');
+				callback(null);
+				return;
+			}
+			if (!json || !json.list || !json.list.length) {
+				console.log('Empty forecast response');
+				callback(null);
+				return;
+			}
+			var points = json.list.map(readReport);
+			if (points.indexOf(null) >= 0) {
+				console.log('Forecast entry has no temperature or conditions');
+				callback(null);
+				return;
+			}
 			
-			// Assemble dictionary using our keys
-			var dictionary = {
-				"KEY_TEMPERATURE": temperature,
-				"KEY_CONDITIONS": conditions
+			var forecast = {
+				key: key,
+				time: Date.now(),
+				start: json.list[0].dt,
+				points: points
 			};
+			console.log('Forecast has ' + forecast.points.length + ' points');
 			
-			// Send to Pebble
-			Pebble.sendAppMessage(dictionary,
-				function(e) {
-					console.log("Weather info sent to Pebble successfully!");
-				},
-				function(e) {
-					console.log("Error sending weather info to Pebble!");
-				}
-			);
+			localStorage.setItem(FORECAST_CACHE_KEY, JSON.stringify(forecast));
+			callback(forecast);
+		},
+		function(reason) {
+			console.log('Giving up on forecast request: ' + reason);
+			callback(null);
 		}
 	);
 }
 
-function locationError(err) {
-	console.log('Error requesting location!');
+function getForecast(callback) {
+	locator.getLocation(function(err, loc) {
+		if (err) {
+			console.log('Error requesting location!');
+			callback(null);
+			return;
+		}
+		fetchForecast(loc, callback);
+	});
 }
 
-function getWeather() {
-	navigator.geolocation.getCurrentPosition(
-		locationSuccess,
-		locationError,
-		{timeout: 15000, maximumAge: 60000}
+// Send the chunks one after the other. If one fails the watch drops the
+// partial forecast and asks again with its next weather request.
+function sendForecast(forecast) {
+	if (!forecast) {
+		return;
+	}
+	
+	var chunks = packForecastChunks(forecast);
+	var sendChunk = function (index) {
+		Pebble.sendAppMessage({ "KEY_FORECAST": chunks[index] },
+			function(e) {
+				if (index + 1 < chunks.length) {
+					sendChunk(index + 1);
+				} else {
+					console.log('Forecast sent to Pebble in ' + chunks.length + ' chunks');
+				}
+			},
+			function(e) {
+				console.log('Error sending forecast chunk ' + index + ' to Pebble!');
+			}
+		);
+	};
+	sendChunk(0);
+}
+
+// Send a report, or nothing when the watch already has it. requested is
+// true when the watch asked for it.
+function sendWeather(weather, requested) {
+	if (!weather) {
+		return;
+	}
+	
+	var timestamp = Math.floor(weather.time / 1000);
+	var last = readLastSent();
+	var dictionary;
+	
+	// Only send what the watch does not already have
+	if (last && last.temperature === weather.temperature && last.conditions === weather.conditions) {
+		// A watch that asked waits for an answer and backs off without one,
+		// so it gets its own timestamp back
+		if (last.timestamp === timestamp && !requested) {
+			console.log('Watch already has this weather');
+			return;
+		}
+		
+		// Same weather, newer fetch: just move the watch's timestamp on
+		dictionary = {
+			"KEY_WEATHER_TIME": timestamp
+		};
+	} else {
+		// Assemble dictionary using our keys
+		dictionary = {
+			"KEY_WEATHER": packWeather(weather.temperature, weather.conditions, timestamp)
+		};
+	}
+	
+	// Say how old the location behind this weather is
+	dictionary.KEY_LOCATION_AGE = weather.locationAge;
+	
+	// Send to Pebble
+	Pebble.sendAppMessage(dictionary,
+		function(e) {
+			localStorage.setItem(LAST_SENT_KEY, JSON.stringify({
+				temperature: weather.temperature,
+				conditions: weather.conditions,
+				timestamp: timestamp
+			}));
+			console.log("Weather info sent to Pebble successfully!");
+		},
+		function(e) {
+			console.log("Error sending weather info to Pebble!");
+		}
 	);
 }
 
-// Listen for when the watchface is opened
-Pebble.addEventListener('ready', function(e) { console.log('PebbleKit JS ready!'); getWeather(); } );
+// Answer a weather request from the watch
+function answerWeather(weather) {
+	sendWeather(weather, true);
+}
+
+// Callbacks waiting on the lookup in flight, null when there is none
+var pending = null;
+
+function finishWeather(weather) {
+	var callbacks = pending;
+	pending = null;
+	callbacks.forEach(function (callback) {
+		callback(weather);
+	});
+}
+
+// Get the weather, sharing one location and network lookup between callers
+// that ask while it is in progress
+function getWeather(callback) {
+	if (pending) {
+		if (pending.indexOf(callback) < 0) {
+			pending.push(callback);
+		}
+		return;
+	}
+	pending = [callback];
+	
+	locator.getLocation(function(err, loc) {
+		if (err) {
+			console.log('Error requesting location!');
+			finishWeather(null);
+			return;
+		}
+		
+		fetchWeather(loc, function(weather) {
+			if (weather) {
+				weather.locationAge = locator.ageMinutes(loc);
+			}
+			finishWeather(weather);
+		});
+	});
+}
+
+// Listen for when the watchface is opened, and send it a full report
+Pebble.addEventListener('ready', function(e) { console.log('PebbleKit JS ready!'); forgetLastSent(); getWeather(sendWeather); profile.ready(); } );
 
 // Listen for when an AppMessage is received 
-Pebble.addEventListener('appmessage', function(e) { console.log('AppMessage received!'); getWeather(); } );
-	
\ No newline at end of file
+Pebble.addEventListener('appmessage', function(e) {
+	console.log('AppMessage received!');
+	
+	// Daily telemetry is not a weather request
+	if (e.payload.KEY_TELEMETRY) {
+		telemetry.receive(e.payload.KEY_TELEMETRY);
+		return;
+	}
+	
+	// Frame timings asked for by profile.ready
+	if (e.payload.KEY_PROFILE) {
+		profile.receive(e.payload.KEY_PROFILE);
+		return;
+	}
+	
+	// The watch asks for a full report when it has none cached
+	var flags = e.payload.KEY_REQUEST;
+	if (flags & REQUEST_FULL_REPORT) {
+		forgetLastSent();
+	}
+	getWeather(answerWeather);
+	
+	// and for the forecast only when its copy is running out
+	if (flags & REQUEST_FORECAST) {
+		getForecast(sendForecast);
+	}
+} );
\ No newline at end of file
@@ -0,0 +1,116 @@
+// Location provider for the weather lookup. GPS is the most expensive thing
+// we ask the phone for, so a fix is reused until it is old, and a new fix
+// only replaces it when we have actually moved.
+
+var LOCATION_KEY = 'lastLocation';
+
+// Reuse a fix younger than this without asking the phone at all
+var MAX_FIX_AGE = 60 * 60 * 1000;
+
+// A new fix closer than this to the stored one keeps the stored coordinates,
+// so the weather cache key stays the same while we stay in the same area
+var MIN_DISTANCE = 1000;
+
+// A coarse fix the phone already has is good enough up to this age
+var COARSE_FIX_AGE = 10 * 60 * 1000;
+
+var LOCATION_TIMEOUT = 15000;
+
+var EARTH_RADIUS = 6371000;
+
+function toRadians(degrees) {
+	return degrees * Math.PI / 180;
+}
+
+// Great-circle distance in metres between two {latitude, longitude} points
+function distance(a, b) {
+	var dLat = toRadians(b.latitude - a.latitude);
+	var dLon = toRadians(b.longitude - a.longitude);
+	var h = Math.sin(dLat / 2) * Math.sin(dLat / 2) +
+		Math.cos(toRadians(a.latitude)) * Math.cos(toRadians(b.latitude)) *
+		Math.sin(dLon / 2) * Math.sin(dLon / 2);
+	return 2 * EARTH_RADIUS * Math.asin(Math.min(1, Math.sqrt(h)));
+}
+
+function readLocation() {
+	try {
+		return JSON.parse(localStorage.getItem(LOCATION_KEY));
+	} catch (e) {
+		return null;
+	}
+}
+
+// Store a new fix, keeping the old coordinates if we have not moved far.
+// The phone may answer with a fix it already had, so its age comes from
+// when it was taken: one no newer than the stored fix changes nothing, and
+// one already past MAX_FIX_AGE is used this once but not stored.
+function storeFix(pos, stored) {
+	var fix = {
+		latitude: pos.coords.latitude,
+		longitude: pos.coords.longitude,
+		time: pos.timestamp || Date.now()
+	};
+	
+	if (stored && fix.time <= stored.time) {
+		return stored;
+	}
+	if (stored && distance(stored, fix) < MIN_DISTANCE) {
+		fix.latitude = stored.latitude;
+		fix.longitude = stored.longitude;
+	}
+	
+	if (Date.now() - fix.time < MAX_FIX_AGE) {
+		localStorage.setItem(LOCATION_KEY, JSON.stringify(fix));
+	}
+	return fix;
+}
+
+// Age of a location in whole minutes
+function ageMinutes(location) {
+	return Math.max(0, Math.floor((Date.now() - location.time) / 60000));
+}
+
+// Call back with (error, {latitude, longitude, time}). Uses the stored fix
+// while it is recent, then a coarse network fix, and powers up GPS only
+// when there is no fix at all.
+function getLocation(callback) {
+	var stored = readLocation();
+	if (stored && Date.now() - stored.time < MAX_FIX_AGE) {
+		callback(null, stored);
+		return;
+	}
+	
+	var highAccuracy = function () {
+		navigator.geolocation.getCurrentPosition(
+			function (pos) {
+				callback(null, storeFix(pos, stored));
+			},
+			function (err) {
+				callback(err);
+			},
+			{enableHighAccuracy: true, timeout: LOCATION_TIMEOUT, maximumAge: 0}
+		);
+	};
+	
+	navigator.geolocation.getCurrentPosition(
+		function (pos) {
+			callback(null, storeFix(pos, stored));
+		},
+		function (err) {
+			// An old fix is still better than waking up GPS
+			if (stored) {
+				console.log('Coarse location failed, reusing the last fix');
+				callback(null, stored);
+			} else {
+				highAccuracy();
+			}
+		},
+		{enableHighAccuracy: false, timeout: LOCATION_TIMEOUT, maximumAge: COARSE_FIX_AGE}
+	);
+}
+
+module.exports = {
+	getLocation: getLocation,
+	ageMinutes: ageMinutes,
+	distance: distance
+};
\ No newline at end of file
@@ -0,0 +1,153 @@
+// Tests for location.js against a stand-in for the phone's geolocation.
+// Not part of the app, run it with node:
+//
+//   node natswatch/src/pkjs/location.test.js
+
+var assert = require('assert');
+
+var MINUTE = 60 * 1000;
+var HOUR = 60 * MINUTE;
+var NOW = 1760000000000;
+
+var storage = {};
+global.localStorage = {
+	getItem: function (key) {
+		return key in storage ? storage[key] : null;
+	},
+	setItem: function (key, value) {
+		storage[key] = String(value);
+	},
+	removeItem: function (key) {
+		delete storage[key];
+	}
+};
+
+// Each call to getCurrentPosition takes the next answer, a position or an
+// error, and records the options it was asked with
+var answers = [];
+var requests = [];
+global.navigator = {
+	geolocation: {
+		getCurrentPosition: function (success, failure, options) {
+			requests.push(options);
+			var answer = answers.shift();
+			assert.ok(answer, 'unexpected location request');
+			if (answer.error) {
+				failure(answer.error);
+			} else {
+				success(answer);
+			}
+		}
+	}
+};
+
+Date.now = function () {
+	return NOW;
+};
+
+var locator = require('./location');
+
+function position(latitude, longitude, age) {
+	return {coords: {latitude: latitude, longitude: longitude}, timestamp: NOW - age};
+}
+
+function stored() {
+	return JSON.parse(storage.lastLocation || 'null');
+}
+
+// Run getLocation with these answers from the phone and return what it
+// called back with
+function locate(phoneAnswers) {
+	answers = phoneAnswers;
+	requests = [];
+	var result = null;
+	locator.getLocation(function (err, loc) {
+		result = {err: err, loc: loc};
+	});
+	assert.strictEqual(answers.length, 0, 'answers left over');
+	assert.ok(result, 'no callback');
+	return result;
+}
+
+var tests = {
+	'first fix is coarse and stored with its own time': function () {
+		var result = locate([position(51.5, -0.12, 2 * MINUTE)]);
+		assert.strictEqual(requests.length, 1);
+		assert.strictEqual(requests[0].enableHighAccuracy, false);
+		assert.ok(requests[0].maximumAge < HOUR);
+		assert.strictEqual(result.loc.time, NOW - 2 * MINUTE);
+		assert.deepStrictEqual(stored(), result.loc);
+	},
+
+	'a recent stored fix is reused without asking the phone': function () {
+		storage.lastLocation = JSON.stringify({latitude: 1, longitude: 2, time: NOW - 30 * MINUTE});
+		var result = locate([]);
+		assert.strictEqual(requests.length, 0);
+		assert.strictEqual(result.loc.latitude, 1);
+	},
+
+	'a fix already past the reuse age is used but not stored': function () {
+		var result = locate([position(51.5, -0.12, 2 * HOUR)]);
+		assert.strictEqual(result.loc.latitude, 51.5);
+		assert.strictEqual(stored(), null);
+	},
+
+	'a fix no newer than the stored one changes nothing': function () {
+		var old = {latitude: 1, longitude: 2, time: NOW - 2 * HOUR};
+		storage.lastLocation = JSON.stringify(old);
+		var result = locate([position(51.5, -0.12, 3 * HOUR)]);
+		assert.deepStrictEqual(result.loc, old);
+		assert.deepStrictEqual(stored(), old);
+	},
+
+	'a nearby fix keeps the stored coordinates': function () {
+		storage.lastLocation = JSON.stringify({latitude: 51.5, longitude: -0.12, time: NOW - 2 * HOUR});
+		var result = locate([position(51.503, -0.12, MINUTE)]);
+		assert.strictEqual(result.loc.latitude, 51.5);
+		assert.strictEqual(result.loc.time, NOW - MINUTE);
+		assert.deepStrictEqual(stored(), result.loc);
+	},
+
+	'a distant fix replaces the stored coordinates': function () {
+		storage.lastLocation = JSON.stringify({latitude: 51.5, longitude: -0.12, time: NOW - 2 * HOUR});
+		var result = locate([position(48.85, 2.35, MINUTE)]);
+		assert.strictEqual(result.loc.latitude, 48.85);
+		assert.deepStrictEqual(stored(), result.loc);
+	},
+
+	'coarse failure reuses an old fix rather than GPS': function () {
+		var old = {latitude: 1, longitude: 2, time: NOW - 2 * HOUR};
+		storage.lastLocation = JSON.stringify(old);
+		var result = locate([{error: {code: 3}}]);
+		assert.strictEqual(requests.length, 1);
+		assert.deepStrictEqual(result.loc, old);
+	},
+
+	'coarse failure without any fix falls back to GPS': function () {
+		var result = locate([{error: {code: 3}}, position(51.5, -0.12, 0)]);
+		assert.strictEqual(requests.length, 2);
+		assert.strictEqual(requests[1].enableHighAccuracy, true);
+		assert.strictEqual(requests[1].maximumAge, 0);
+		assert.deepStrictEqual(stored(), result.loc);
+	},
+
+	'GPS failure is passed on': function () {
+		var result = locate([{error: {code: 3}}, {error: {code: 1}}]);
+		assert.deepStrictEqual(result.err, {code: 1});
+	}
+};
+
+var failed = 0;
+Object.keys(tests).forEach(function (name) {
+	storage = {};
+	try {
+		tests[name]();
+		console.log('ok ' + name);
+	} catch (e) {
+		failed++;
+		console.log('FAIL ' + name + ': ' + e.message);
+	}
+});
+if (failed) {
+	process.exit(1);
+}
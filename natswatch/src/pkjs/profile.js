@@ -0,0 +1,67 @@
+// Frame timings from a watch built with PROFILER, see profile.h for the
+// layout. The watch only answers the dump request in a profiling build.
+
+var PROFILE_FORMAT_VERSION = 1;
+
+// Set to ask the watch for its timings each time the app starts
+var REQUEST_ON_READY = false;
+
+// in the order of ProfileElement in profile.h
+var ELEMENTS = ['day', 'time', 'date', 'conditions', 'temperature', 'forecast', 'bluetooth', 'battery', 'frame'];
+
+function read16(bytes, offset) {
+	return bytes[offset] | bytes[offset + 1] << 8;
+}
+
+function read32(bytes, offset) {
+	return (read16(bytes, offset) | read16(bytes, offset + 2) << 16) >>> 0;
+}
+
+function request() {
+	Pebble.sendAppMessage({ 'KEY_PROFILE': 0 },
+		function(e) { console.log('Profile dump requested'); },
+		function(e) { console.log('Error requesting profile dump'); }
+	);
+}
+
+function ready() {
+	if (REQUEST_ON_READY) {
+		request();
+	}
+}
+
+// Log the summary, the slowest elements first
+function receive(bytes) {
+	if (bytes[0] !== PROFILE_FORMAT_VERSION) {
+		console.log('Ignoring profile format ' + bytes[0]);
+		return;
+	}
+	
+	console.log('Profile: ' + read16(bytes, 2) + ' frames in the last minute, ' +
+		read16(bytes, 4) + ' in the busiest');
+	
+	var elements = [];
+	var offset = 6;
+	for (var i = 0; i < bytes[1]; i++) {
+		elements.push({
+			name: ELEMENTS[i] || 'element ' + i,
+			draws: read32(bytes, offset),
+			min: read16(bytes, offset + 4),
+			mean: read16(bytes, offset + 6) / 10,
+			p95: read16(bytes, offset + 8),
+			max: read16(bytes, offset + 10)
+		});
+		offset += 12;
+	}
+	
+	elements.sort(function(a, b) { return b.mean - a.mean; });
+	elements.forEach(function(element) {
+		console.log('Profile ' + element.name + ': ' + element.draws + ' draws, min ' + element.min +
+			'ms, mean ' + element.mean.toFixed(1) + 'ms, p95 ' + element.p95 + 'ms, max ' + element.max + 'ms');
+	});
+}
+
+module.exports = {
+	ready: ready,
+	receive: receive
+};
@@ -0,0 +1,105 @@
+// Daily power telemetry from the watch. The watch batches every finished
+// day it has not delivered yet into one message, see telemetry.h for the
+// layout. Days are kept here so drain can be compared across app versions.
+
+var TELEMETRY_FORMAT_VERSION = 2;
+var TELEMETRY_KEY = 'telemetry';
+
+// Keep this many days, the oldest are dropped
+var MAX_DAYS = 60;
+
+// in the order of TelemetryCounter in telemetry.h
+var COUNTERS = ['ticks', 'outboxSent', 'outboxFailed', 'inboxMessages', 'vibes', 'btFlips', 'secondTicks'];
+var HOURS_PER_DAY = 24;
+var CHARGE_UNKNOWN = 0xFF;
+
+function read16(bytes, offset) {
+	return bytes[offset] | bytes[offset + 1] << 8;
+}
+
+function read32(bytes, offset) {
+	return (read16(bytes, offset) | read16(bytes, offset + 2) << 16) >>> 0;
+}
+
+function decodeDay(bytes, offset) {
+	var day = { date: read32(bytes, offset) };
+	offset += 4;
+	
+	COUNTERS.forEach(function(name) {
+		day[name] = read16(bytes, offset);
+		offset += 2;
+	});
+	day.inboxBytes = read32(bytes, offset);
+	day.renderMs = read32(bytes, offset + 4);
+	var charging = read32(bytes, offset + 8);
+	offset += 12;
+	
+	day.charge = [];
+	day.charging = [];
+	for (var hour = 0; hour < HOURS_PER_DAY; hour++) {
+		var charge = bytes[offset + hour];
+		day.charge.push(charge === CHARGE_UNKNOWN ? null : charge);
+		day.charging.push((charge !== CHARGE_UNKNOWN) && !!(charging & (1 << hour)));
+	}
+	return { day: day, next: offset + HOURS_PER_DAY };
+}
+
+// Percent lost per hour over the hours spent off the charger. A rise means
+// it was charged between samples, so that hour is left out too.
+function drainPerHour(day) {
+	var lost = 0;
+	var hours = 0;
+	for (var hour = 1; hour < HOURS_PER_DAY; hour++) {
+		var before = day.charge[hour - 1];
+		var after = day.charge[hour];
+		if (before !== null && after !== null && after <= before && !day.charging[hour]) {
+			lost += before - after;
+			hours++;
+		}
+	}
+	return hours ? lost / hours : null;
+}
+
+function readDays() {
+	try {
+		return JSON.parse(localStorage.getItem(TELEMETRY_KEY)) || {};
+	} catch (e) {
+		return {};
+	}
+}
+
+// Store a batch from the watch, a day sent twice replaces the first copy
+function receive(bytes) {
+	if (bytes[0] !== TELEMETRY_FORMAT_VERSION) {
+		console.log('Ignoring telemetry format ' + bytes[0]);
+		return;
+	}
+	
+	var days = readDays();
+	var offset = 2;
+	for (var i = 0; i < bytes[1]; i++) {
+		var decoded = decodeDay(bytes, offset);
+		var day = decoded.day;
+		offset = decoded.next;
+		
+		day.drainPerHour = drainPerHour(day);
+		days[day.date] = day;
+		console.log('Telemetry ' + day.date + ': ' + day.ticks + ' ticks, ' +
+			day.outboxSent + ' sent, ' + day.outboxFailed + ' failed, ' +
+			day.inboxMessages + ' received (' + day.inboxBytes + ' bytes), ' +
+			day.vibes + ' vibes, ' + day.btFlips + ' BT flips, ' + day.secondTicks + ' second ticks, ' +
+			day.renderMs + ' ms drawing, ' +
+			(day.drainPerHour === null ? 'no' : day.drainPerHour.toFixed(1) + '%') + ' drain per hour');
+	}
+	
+	// Drop the oldest days
+	var dates = Object.keys(days).sort();
+	dates.slice(0, Math.max(0, dates.length - MAX_DAYS)).forEach(function(date) {
+		delete days[date];
+	});
+	localStorage.setItem(TELEMETRY_KEY, JSON.stringify(days));
+}
+
+module.exports = {
+	receive: receive
+};
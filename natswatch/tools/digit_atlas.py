@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# Rasterize the clock digits from a font into one bitmap atlas resource.
+#
+# The glyphs "0123456789:" are drawn white on a transparent background into
+# equal width cells laid out left to right, so the watch can blit a cell per
+# character instead of laying out text with the font. The cell size is not
+# stored anywhere: the watch divides the atlas width by the glyph count.
+#
+#   python3 tools/digit_atlas.py resources/fonts/helsinki.ttf 48 \
+#       resources/images/digit_atlas.png
+#
+# Run it again whenever the font or its size changes.
+
+import argparse
+
+from PIL import Image, ImageDraw, ImageFont
+
+# must match ATLAS_GLYPHS in src/c/display.c
+GLYPHS = "0123456789:"
+
+
+def build_atlas(font_path, size, threshold):
+	font = ImageFont.truetype(font_path, size)
+	ascent, descent = font.getmetrics()
+
+	# one cell fits the widest glyph, so every character advances the same
+	cell_w = max(int(round(font.getlength(g))) for g in GLYPHS)
+	cell_h = ascent + descent
+
+	atlas = Image.new("L", (cell_w * len(GLYPHS), cell_h), 0)
+	draw = ImageDraw.Draw(atlas)
+	for i, glyph in enumerate(GLYPHS):
+		# centre each glyph in its cell, all sharing the font's baseline
+		x = i * cell_w + (cell_w - font.getlength(glyph)) / 2
+		draw.text((x, 0), glyph, font=font, fill=255)
+
+	# the watch has no anti-aliasing for bitmaps, keep pixels fully on or off
+	alpha = atlas.point(lambda v: 255 if v >= threshold else 0)
+
+	image = Image.new("RGBA", atlas.size, (255, 255, 255, 0))
+	image.putalpha(alpha)
+	return image, cell_w, cell_h
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Build the clock digit atlas from a font")
+	parser.add_argument("font", help="TrueType font to rasterize")
+	parser.add_argument("size", type=int, help="font size in pixels, as in the resource name")
+	parser.add_argument("output", help="PNG to write")
+	parser.add_argument("--threshold", type=int, default=128,
+		help="coverage (0-255) at which a pixel is drawn")
+	args = parser.parse_args()
+
+	image, cell_w, cell_h = build_atlas(args.font, args.size, args.threshold)
+	image.save(args.output)
+	print("%s: %d glyphs of %dx%d" % (args.output, len(GLYPHS), cell_w, cell_h))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,475 @@
+#!/usr/bin/env python3
+# Record and replay the events a face receives, see event_trace.h in any
+# face for the trace format.
+#
+# Record: build a face with EVENT_TRACE_RECORD, wear it or drive the
+# emulator, and keep the log, then pull the trace out of it:
+#
+#   pebble logs > natswatch.log
+#   python3 tools/event_trace.py extract natswatch.log natswatch.trace
+#
+# Replay: write the trace into the face, build it with EVENT_TRACE_REPLAY
+# and keep the log of the run:
+#
+#   python3 tools/event_trace.py header natswatch.trace natswatch/src/c/event_trace_data.h
+#
+# check --update stores the results of a replay as the baseline, later
+# replays are compared with it. Call and redraw counts must match, and
+# times may grow by --tolerance before the check fails. Times only compare
+# on the machine that stored the baseline, --counts leaves them out:
+#
+#   python3 tools/event_trace.py check --update replay.log natswatch.baseline.json
+#   python3 tools/event_trace.py check replay.log natswatch.baseline.json
+#
+# tools/host/check.sh does this for the traces committed under <face>/test.
+#
+# dump prints the events of a trace.
+#
+# A trace can also be written as text, to synthesize a day instead of
+# recording one, and dump prints a trace the same way:
+#
+#   python3 tools/event_trace.py build natswatch/test/day.txt day.trace
+#
+#   start 2026-03-02 00:00      UTC, the first line
+#   07:00 battery 80 plugged    HH:MM[:SS] since midnight of the start day,
+#   07:15 tap y 1               past 24:00 on the days after
+#   12:00 connection off
+#   12:30 inbox 2:data=0101f6{time}
+#   every 15m from 07:00 until 23:00 tap x -1
+#
+# The events are tick [UNITS], battery PERCENT [charging] [plugged],
+# connection on|off, tap x|y|z 1|-1, and inbox KEY:TYPE=VALUE... where TYPE
+# is data (hex, {time} writes the event time as 4 bytes), string, int8,
+# int16, int32, uint8, uint16 or uint32. A tick without units gets those
+# that changed since the tick before. every repeats an event each N s, m or
+# h up to but not including the until time, and events at the same time
+# keep the order of their lines.
+
+import argparse
+import calendar
+import json
+import os
+import re
+import struct
+import sys
+import time
+
+FORMAT_VERSION = 1
+
+# in the order of EventType in event_trace.h
+EVENTS = ["start", "tick", "battery", "connection", "tap", "inbox"]
+
+# times this small are mostly noise
+MIN_COMPARED_MS = 20
+
+# keys that hold a time, and what MIN_COMPARED_MS is in their unit
+TIME_UNITS = {"ms": 1, "_us": 1000}
+
+# TimeUnits bits
+SECOND_UNIT, MINUTE_UNIT, HOUR_UNIT, DAY_UNIT, MONTH_UNIT, YEAR_UNIT = (1 << i for i in range(6))
+
+AXES = "xyz"
+
+# Tuple types and the integer widths of the text format
+TUPLE_TYPES = {"data": 0, "string": 1, "uint": 2, "int": 3}
+INTEGERS = {"int8": "<b", "int16": "<h", "int32": "<i", "uint8": "<B", "uint16": "<H", "uint32": "<I"}
+
+LINE = re.compile(r"event trace ([0-9a-f]{2}) ([0-9a-f]+)")
+RESULT = re.compile(r"replay (\w+): (.*)")
+
+
+# Join the logged lines of the last recording in the log
+def extract(log):
+	sessions = []
+	expected = None
+	for line in log:
+		match = LINE.search(line)
+		if not match:
+			continue
+		number, data = int(match.group(1), 16), bytes.fromhex(match.group(2))
+		if data.startswith(b"ET") and number == 0:
+			sessions.append(bytearray())
+			expected = 0
+		elif not sessions:
+			continue
+		if number != expected:
+			sys.exit("line %02x of the trace is missing from the log" % expected)
+		sessions[-1] += data
+		expected = (number + 1) % 256
+
+	if not sessions:
+		sys.exit("no event trace in the log")
+	if len(sessions) > 1:
+		print("%d recordings in the log, keeping the last" % len(sessions))
+	return bytes(sessions[-1])
+
+
+def read_varint(trace, offset):
+	value, shift = 0, 0
+	while True:
+		byte = trace[offset]
+		offset += 1
+		value |= (byte & 0x7F) << shift
+		if not byte & 0x80:
+			return value, offset
+		shift += 7
+
+
+# Yield (name, time, fields) for each event, the same steps as the replay
+def parse(trace):
+	if trace[:2] != b"ET" or trace[2] != FORMAT_VERSION:
+		raise ValueError("not a version %d event trace" % FORMAT_VERSION)
+
+	offset = 3
+	now = 0
+	while offset < len(trace):
+		kind = trace[offset]
+		if kind >= len(EVENTS):
+			raise ValueError("unknown event %d at byte %d" % (kind, offset))
+		delta, offset = read_varint(trace, offset + 1)
+		now += delta
+
+		name = EVENTS[kind]
+		if name == "start":
+			now, = struct.unpack_from("<I", trace, offset)
+			fields = {}
+			offset += 4
+		elif name == "tick":
+			units, sec, minute, hour, mday, mon, year, wday, yday = struct.unpack_from("<8BH", trace, offset)
+			fields = {"units": units, "time": "%04d-%02d-%02d %02d:%02d:%02d"
+				% (year + 1900, mon + 1, mday, hour, minute, sec)}
+			offset += 10
+		elif name == "battery":
+			percent, flags = struct.unpack_from("<2B", trace, offset)
+			fields = {"percent": percent, "charging": bool(flags & 1), "plugged": bool(flags & 2)}
+			offset += 2
+		elif name == "connection":
+			fields = {"connected": bool(trace[offset])}
+			offset += 1
+		elif name == "tap":
+			axis, direction = struct.unpack_from("<Bb", trace, offset)
+			fields = {"axis": axis, "direction": direction}
+			offset += 2
+		else:
+			length, = struct.unpack_from("<H", trace, offset)
+			fields = {"bytes": length, "dictionary": trace[offset + 2:offset + 2 + length]}
+			offset += 2 + length
+		yield name, now, fields
+
+
+def write_varint(value):
+	out = bytearray()
+	while value >= 0x80:
+		out.append(value & 0x7F | 0x80)
+		value >>= 7
+	out.append(value)
+	return bytes(out)
+
+
+# struct tm fields of a UTC time, in trace order
+def tm_fields(seconds):
+	t = time.gmtime(seconds)
+	return (t.tm_sec, t.tm_min, t.tm_hour, t.tm_mday, t.tm_mon - 1, t.tm_year - 1900,
+		(t.tm_wday + 1) % 7, t.tm_yday - 1)
+
+
+# The units that differ between two times, as the watch reports them
+def units_changed(before, now):
+	a, b = tm_fields(before), tm_fields(now)
+	units = 0
+	for bit, index in ((SECOND_UNIT, 0), (MINUTE_UNIT, 1), (HOUR_UNIT, 2), (DAY_UNIT, 3),
+			(MONTH_UNIT, 4), (YEAR_UNIT, 5)):
+		if a[index] != b[index]:
+			units |= bit
+	return units
+
+
+def parse_clock(text):
+	parts = text.split(":")
+	if not 2 <= len(parts) <= 3 or not all(part.isdigit() for part in parts):
+		raise ValueError("not a time: %s" % text)
+	hours, minutes, seconds = (int(part) for part in parts + ["0"] * (3 - len(parts)))
+	return hours * 3600 + minutes * 60 + seconds
+
+
+def format_clock(seconds):
+	clock = "%02d:%02d" % (seconds // 3600, seconds // 60 % 60)
+	return clock + (":%02d" % (seconds % 60) if seconds % 60 else "")
+
+
+def parse_start(text):
+	for layout in ("%Y-%m-%d %H:%M", "%Y-%m-%d %H:%M:%S"):
+		try:
+			return calendar.timegm(time.strptime(text, layout))
+		except ValueError:
+			pass
+	raise ValueError("not a start time: %s" % text)
+
+
+def parse_period(text):
+	match = re.match(r"(\d+)([smh])$", text)
+	if not match or int(match.group(1)) == 0:
+		raise ValueError("not a period: %s" % text)
+	return int(match.group(1)) * {"s": 1, "m": 60, "h": 3600}[match.group(2)]
+
+
+# A dictionary as the watch receives it: count, then key, type, length and
+# value of each tuple
+def encode_dictionary(tuples, now):
+	out = bytearray([len(tuples)])
+	for item in tuples:
+		match = re.match(r"(\d+):(\w+)=(.*)$", item)
+		if not match:
+			raise ValueError("not a tuple: %s" % item)
+		key, kind, value = int(match.group(1)), match.group(2), match.group(3)
+		if kind == "data":
+			value = bytes.fromhex(value.replace("{time}", struct.pack("<I", now).hex()))
+		elif kind == "string":
+			value = value.encode() + b"\0"
+		elif kind in INTEGERS:
+			value = struct.pack(INTEGERS[kind], int(value))
+			kind = "uint" if kind.startswith("u") else "int"
+		else:
+			raise ValueError("unknown tuple type %s" % kind)
+		out += struct.pack("<IBH", key, TUPLE_TYPES[kind], len(value)) + value
+	return bytes(out)
+
+
+def decode_dictionary(data):
+	count, offset = data[0], 1
+	tuples = []
+	for _ in range(count):
+		key, kind, length = struct.unpack_from("<IBH", data, offset)
+		offset += 7
+		value = data[offset:offset + length]
+		offset += length
+		if kind == TUPLE_TYPES["string"] and value.endswith(b"\0") and b" " not in value:
+			tuples.append("%d:string=%s" % (key, value[:-1].decode()))
+		elif kind in (TUPLE_TYPES["int"], TUPLE_TYPES["uint"]) and length in (1, 2, 4):
+			name = ("int" if kind == TUPLE_TYPES["int"] else "uint") + str(8 * length)
+			tuples.append("%d:%s=%d" % (key, name, struct.unpack(INTEGERS[name], value)[0]))
+		else:
+			tuples.append("%d:data=%s" % (key, value.hex()))
+	return tuples
+
+
+# The payload of an event written as text
+def encode_event(words, now, last_tick):
+	name, args = words[0], words[1:]
+	if name == "tick":
+		units = int(args[0]) if args else units_changed(last_tick, now)
+		return struct.pack("<B", units) + struct.pack("<7BH", *tm_fields(now))
+	if name == "battery":
+		flags = ("charging" in args[1:]) | ("plugged" in args[1:]) << 1
+		return struct.pack("<2B", int(args[0]), flags)
+	if name == "connection":
+		if args != ["on"] and args != ["off"]:
+			raise ValueError("connection is on or off")
+		return bytes([args[0] == "on"])
+	if name == "tap":
+		return struct.pack("<Bb", AXES.index(args[0]), int(args[1]))
+	if name == "inbox":
+		dictionary = encode_dictionary(args, now)
+		return struct.pack("<H", len(dictionary)) + dictionary
+	raise ValueError("unknown event %s" % name)
+
+
+# Turn a text trace into a binary one
+def build(lines):
+	start = None
+	events = []
+	for number, line in enumerate(lines, 1):
+		words = line.split("#")[0].split()
+		if not words:
+			continue
+		try:
+			if start is None:
+				if words[0] != "start":
+					raise ValueError("the first line is start DATE TIME")
+				start = parse_start(" ".join(words[1:]))
+				midnight = start - start % 86400
+			elif words[0] == "every":
+				if words[2] != "from" or words[4] != "until":
+					raise ValueError("every PERIOD from TIME until TIME EVENT")
+				period = parse_period(words[1])
+				for at in range(parse_clock(words[3]), parse_clock(words[5]), period):
+					events.append((midnight + at, number, words[6:]))
+			else:
+				events.append((midnight + parse_clock(words[0]), number, words[1:]))
+		except (ValueError, IndexError) as error:
+			sys.exit("line %d: %s" % (number, error))
+	if start is None:
+		sys.exit("no start line")
+
+	trace = bytearray(b"ET" + bytes([FORMAT_VERSION]))
+	trace += bytes([EVENTS.index("start")]) + write_varint(0) + struct.pack("<I", start)
+	now = start
+	last_tick = None
+	for at, number, words in sorted(events, key=lambda event: event[:2]):
+		if at < start:
+			sys.exit("line %d: before the start" % number)
+		try:
+			payload = encode_event(words, at, at - 1 if last_tick is None else last_tick)
+		except (ValueError, IndexError, struct.error) as error:
+			sys.exit("line %d: %s" % (number, error))
+		if words[0] == "tick":
+			last_tick = at
+		trace += bytes([EVENTS.index(words[0])]) + write_varint(at - now) + payload
+		now = at
+	return bytes(trace)
+
+
+# Print a trace in the text format build reads
+def dump(trace):
+	midnight = None
+	last_tick = None
+	for name, now, fields in parse(trace):
+		if name == "start":
+			midnight = now - now % 86400
+			print("start " + time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(now)))
+			continue
+
+		words = [format_clock(now - midnight), name]
+		if name == "tick":
+			if fields["units"] != units_changed(now - 1 if last_tick is None else last_tick, now):
+				words.append(str(fields["units"]))
+			last_tick = now
+		elif name == "battery":
+			words.append(str(fields["percent"]))
+			words += [flag for flag in ("charging", "plugged") if fields[flag]]
+		elif name == "connection":
+			words.append("on" if fields["connected"] else "off")
+		elif name == "tap":
+			words += [AXES[fields["axis"]], str(fields["direction"])]
+		else:
+			words += decode_dictionary(fields["dictionary"])
+		print(" ".join(words))
+
+
+def header(trace, name):
+	lines = ["// Event trace for EVENT_TRACE_REPLAY, written by tools/event_trace.py from",
+		"// %s, %d bytes" % (name, len(trace)),
+		"static const uint8_t s_event_trace[] = {"]
+	for start in range(0, len(trace), 16):
+		lines.append("\t" + ", ".join("0x%02x" % b for b in trace[start:start + 16]) + ",")
+	lines.append("};")
+	return "\n".join(lines) + "\n"
+
+
+# Results of a replay as {"tick": {"calls": 1440, ...}, ...}
+def results(log):
+	found = {}
+	for line in log:
+		match = RESULT.search(line)
+		if match:
+			found[match.group(1)] = dict((key, int(value)) for key, value in
+				(pair.split("=") for pair in match.group(2).split()))
+	if "done" not in found:
+		sys.exit("no finished replay in the log")
+	return found
+
+
+def time_scale(key):
+	for suffix, scale in TIME_UNITS.items():
+		if key.endswith(suffix):
+			return scale
+	return None
+
+
+def compare(baseline, current, tolerance, counts_only):
+	failures = []
+	for name, values in sorted(baseline.items()):
+		for key, expected in sorted(values.items()):
+			actual = current.get(name, {}).get(key)
+			scale = time_scale(key)
+			if actual is None:
+				failures.append("%s %s is missing" % (name, key))
+			elif scale:
+				limit = max(expected * (1 + tolerance), MIN_COMPARED_MS * scale)
+				if actual > limit and not counts_only:
+					failures.append("%s %s %d, was %d" % (name, key, actual, expected))
+			elif actual != expected:
+				failures.append("%s %s %d, was %d" % (name, key, actual, expected))
+	return failures
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Record and replay the events a face receives")
+	commands = parser.add_subparsers(dest="command", required=True)
+
+	command = commands.add_parser("extract", help="pull a recorded trace out of a log")
+	command.add_argument("log")
+	command.add_argument("trace")
+
+	command = commands.add_parser("header", help="write a trace as event_trace_data.h")
+	command.add_argument("trace")
+	command.add_argument("output")
+
+	command = commands.add_parser("dump", help="print the events of a trace as text")
+	command.add_argument("trace")
+
+	command = commands.add_parser("build", help="write a trace from text")
+	command.add_argument("text")
+	command.add_argument("trace")
+
+	command = commands.add_parser("check", help="compare a replay with its baseline")
+	command.add_argument("log")
+	command.add_argument("baseline")
+	command.add_argument("--tolerance", type=float, default=0.2,
+		help="fraction times may grow by, 0.2 allows 20%%")
+	command.add_argument("--counts", action="store_true", help="compare counts and leave out times")
+	command.add_argument("--update", action="store_true", help="store this replay as the baseline")
+	args = parser.parse_args()
+
+	if args.command == "extract":
+		with open(args.log, errors="replace") as f:
+			trace = extract(f)
+		counts = {}
+		for name, _, _ in parse(trace):
+			counts[name] = counts.get(name, 0) + 1
+		with open(args.trace, "wb") as f:
+			f.write(trace)
+		print("%s: %d bytes, %s" % (args.trace, len(trace),
+			", ".join("%d %s" % (counts[name], name) for name in EVENTS if name in counts)))
+
+	elif args.command == "header":
+		with open(args.trace, "rb") as f:
+			trace = f.read()
+		list(parse(trace))
+		with open(args.output, "w") as f:
+			f.write(header(trace, os.path.basename(args.trace)))
+
+	elif args.command == "dump":
+		with open(args.trace, "rb") as f:
+			dump(f.read())
+
+	elif args.command == "build":
+		with open(args.text) as f:
+			trace = build(f)
+		with open(args.trace, "wb") as f:
+			f.write(trace)
+
+	else:
+		with open(args.log, errors="replace") as f:
+			current = results(f)
+		if args.update:
+			with open(args.baseline, "w") as f:
+				json.dump(current, f, indent="\t", sort_keys=True)
+				f.write("\n")
+			print("stored %s" % args.baseline)
+			return
+
+		if not os.path.exists(args.baseline):
+			sys.exit("no baseline %s, store one with --update" % args.baseline)
+		with open(args.baseline) as f:
+			baseline = json.load(f)
+		failures = compare(baseline, current, args.tolerance, args.counts)
+		for failure in failures:
+			print("regression: " + failure)
+		if failures:
+			sys.exit(1)
+		print("replay matches %s" % args.baseline)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+# Turn the frames a face logged with FRAME_CAPTURE_DUMP into PNG files and
+# compare them with golden frames, see frame_capture.h in any face.
+#
+#   pebble logs > natswatch.log
+#   python3 tools/frame_capture.py png natswatch.log frames/
+#
+# Golden frames need the same frames every run, so replay an event trace
+# (tools/event_trace.py) while capturing. check --update stores the
+# frames as golden, later checks fail when a pixel differs:
+#
+#   python3 tools/frame_capture.py check --update natswatch.log natswatch/golden/
+#   python3 tools/frame_capture.py check natswatch.log natswatch/golden/
+#
+# tools/host/check.sh does this for the golden frames under natswatch/test.
+#
+# minutes prints the pixels each minute's frames changed, which every
+# build logs with FRAME_CAPTURE alone.
+
+import argparse
+import os
+import re
+import sys
+
+from PIL import Image
+
+SIZE = re.compile(r"frame (\d+) size (\d+)x(\d+) bits (\d+)")
+ROW = re.compile(r"frame (\d+) row (\d+) byte (\d+) ([0-9a-f]+)")
+HASH = re.compile(r"frame (\d+) hash ([0-9a-f]{8})")
+MINUTE = re.compile(r"frame minute: frames=(\d+) changed=(\d+)")
+FRAME_NAME = re.compile(r"frame_\d{5}\.png$")
+
+# must match frame_capture.c
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+
+
+class Frame:
+	def __init__(self, width, height, bits):
+		self.width, self.height, self.bits = width, height, bits
+		self.rows = [bytearray((width * bits + 7) // 8) for _ in range(height)]
+		# pixels outside a round display are not logged
+		self.visible = [[False] * width for _ in range(height)]
+		self.hash = None
+
+	def add(self, y, start, data):
+		self.rows[y][start:start + len(data)] = data
+		for byte in range(start, start + len(data)):
+			for x in range(byte * 8 // self.bits, (byte + 1) * 8 // self.bits):
+				if x < self.width:
+					self.visible[y][x] = True
+
+	def pixel(self, x, y):
+		row = self.rows[y]
+		return row[x] if self.bits == 8 else row[x // 8] >> (x % 8) & 1
+
+	def pixel_hash(self):
+		value = FNV_OFFSET
+		for y in range(self.height):
+			for x in range(self.width):
+				if self.visible[y][x]:
+					value = ((value ^ self.pixel(x, y)) * FNV_PRIME) & 0xFFFFFFFF
+		return value
+
+	# 8 bit pixels are GColor8, 0b11rrggbb
+	def image(self):
+		image = Image.new("RGB", (self.width, self.height))
+		for y in range(self.height):
+			for x in range(self.width):
+				value = self.pixel(x, y)
+				if self.bits == 1:
+					rgb = (255, 255, 255) if value else (0, 0, 0)
+				else:
+					rgb = tuple(85 * (value >> shift & 3) for shift in (4, 2, 0))
+				image.putpixel((x, y), rgb)
+		return image
+
+
+# Frames dumped in the log by number, checked against their logged hash
+def read_frames(log):
+	frames = {}
+	for line in log:
+		match = SIZE.search(line)
+		if match:
+			number, width, height, bits = (int(g) for g in match.groups())
+			frames[number] = Frame(width, height, bits)
+			continue
+		match = ROW.search(line)
+		if match and int(match.group(1)) in frames:
+			frames[int(match.group(1))].add(int(match.group(2)), int(match.group(3)),
+				bytes.fromhex(match.group(4)))
+			continue
+		match = HASH.search(line)
+		if match and int(match.group(1)) in frames:
+			frames[int(match.group(1))].hash = int(match.group(2), 16)
+
+	for number, frame in sorted(frames.items()):
+		if frame.hash is not None and frame.hash != frame.pixel_hash():
+			sys.exit("frame %d does not match its hash, lines are missing from the log" % number)
+	if not frames:
+		sys.exit("no dumped frames in the log")
+	return frames
+
+
+def name(number):
+	return "frame_%05d.png" % number
+
+
+def differences(a, b):
+	if a.size != b.size:
+		return a.size[0] * a.size[1]
+	pa, pb = a.load(), b.load()
+	return sum(1 for y in range(a.size[1]) for x in range(a.size[0]) if pa[x, y] != pb[x, y])
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Export captured frames and compare them with golden frames")
+	commands = parser.add_subparsers(dest="command", required=True)
+
+	command = commands.add_parser("png", help="write each dumped frame as a PNG")
+	command.add_argument("log")
+	command.add_argument("directory")
+
+	command = commands.add_parser("check", help="compare dumped frames with golden PNGs")
+	command.add_argument("log")
+	command.add_argument("golden", help="directory of golden frames")
+	command.add_argument("--update", action="store_true", help="store these frames as golden")
+
+	command = commands.add_parser("minutes", help="print the pixels changed each minute")
+	command.add_argument("log")
+	args = parser.parse_args()
+
+	with open(args.log, errors="replace") as f:
+		log = f.readlines()
+
+	if args.command == "minutes":
+		total = 0
+		for minute, match in enumerate(filter(None, map(MINUTE.search, log))):
+			frames, changed = int(match.group(1)), int(match.group(2))
+			total += changed
+			print("minute %d: %d frames, %d pixels changed" % (minute, frames, changed))
+		print("%d pixels changed in all" % total)
+		return
+
+	frames = read_frames(log)
+	directory = args.directory if args.command == "png" else args.golden
+	if args.command == "png" or args.update:
+		os.makedirs(directory, exist_ok=True)
+		# frames of an earlier, longer run would be left behind
+		for stale in set(os.listdir(directory)) - set(map(name, frames)):
+			if FRAME_NAME.match(stale):
+				os.remove(os.path.join(directory, stale))
+		for number, frame in sorted(frames.items()):
+			frame.image().save(os.path.join(directory, name(number)))
+		print("wrote %d frames to %s" % (len(frames), directory))
+		return
+
+	if not os.path.isdir(directory):
+		sys.exit("no golden frames in %s, store them with --update" % directory)
+	failures = 0
+	for number, frame in sorted(frames.items()):
+		path = os.path.join(directory, name(number))
+		if not os.path.exists(path):
+			print("frame %d has no golden frame" % number)
+			failures += 1
+			continue
+		changed = differences(frame.image(), Image.open(path).convert("RGB"))
+		if changed:
+			print("frame %d: %d pixels differ from %s" % (number, changed, path))
+			failures += 1
+	for extra in sorted(set(os.listdir(directory)) - set(map(name, frames))):
+		if FRAME_NAME.match(extra):
+			print("%s was not drawn" % os.path.join(directory, extra))
+			failures += 1
+	if failures:
+		sys.exit(1)
+	print("%d frames match %s" % (len(frames), directory))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Build a face for Linux against the SDK shim in this directory. The
+# program runs the face's real callbacks, with main renamed to face_main,
+# under a driver: replay.c by default, or a test driver.
+#
+#   tools/host/build.sh natswatch
+#   tools/host/build.sh -o _host_build/single natswatch -DSINGLE_LAYER_RENDER
+#   tools/host/build.sh -d tools/host/tests/rle_decode.c battlev
+#
+# Arguments after the face are compiler flags, for example the build flags
+# the face's headers leave commented out. -DPBL_ROUND builds for the round
+# 180x180 screen. The program is written to _host_build/<face>/replay
+# unless -o names it.
+
+set -e
+
+host=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$host/../.." && pwd)
+driver=$host/replay.c
+output=
+
+while getopts "d:o:" option; do
+	case $option in
+		d) driver=$2 ;;
+		o) output=$2 ;;
+		*) exit 2 ;;
+	esac
+	shift 2
+	OPTIND=1
+done
+
+face=$1
+if [ -z "$face" ] || [ ! -d "$root/$face/src/c" ]; then
+	echo "usage: build.sh [-d driver.c] [-o program] face [cflags...]" >&2
+	exit 2
+fi
+shift
+
+output=${output:-$root/_host_build/$face/$(basename "$driver" .c)}
+objects=$(dirname "$output")/obj-$(basename "$output")
+mkdir -p "$objects"
+rm -f "$objects"/*.o
+
+cc=${CC:-cc}
+cflags="-std=gnu99 -O2 -g -I$host"
+
+# The face keeps the compiler's default warnings, the shim gets all of them
+for source in "$root/$face"/src/c/*.c; do
+	$cc $cflags -I"$root/$face/src/c" -Dmain=face_main "$@" -c "$source" \
+		-o "$objects/$(basename "$source" .c).o"
+done
+$cc $cflags -Wall "$@" -c "$host/pebble_host.c" -o "$objects/pebble_host.o"
+$cc $cflags -Wall -I"$root/$face/src/c" "$@" -c "$driver" -o "$objects/driver.o"
+$cc -o "$output" "$objects"/*.o -lm
+
+echo "$output"
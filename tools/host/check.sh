@@ -0,0 +1,72 @@
+#!/bin/sh
+# Replay the committed test traces through their faces on this computer and
+# compare what each face did with its committed baseline. Times depend on
+# the machine, so only the counts are compared.
+#
+#   tools/host/check.sh
+#   tools/host/check.sh --update
+#
+# --update stores the results of this run as the new baselines. A replay
+# test is a <face>/test/<name>.txt trace with its <name>.json baseline next
+# to it. A frames test captures every frame of such a trace and compares
+# them with the golden PNGs in <name>-<screen>/.
+
+set -e
+
+host=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$host/../.." && pwd)
+work=$root/_host_build/check
+update=
+
+if [ "$1" = "--update" ]; then
+	update=--update
+fi
+mkdir -p "$work"
+
+failed=0
+
+# replay FACE NAME [cflags...]
+replay() {
+	face=$1
+	name=$2
+	shift 2
+	program=$work/$face-$name
+	log=$("$host/build.sh" -o "$program" "$face" "$@" 2>&1) || {
+		echo "$log"
+		exit 1
+	}
+	python3 "$root/tools/event_trace.py" build "$root/$face/test/$name.txt" "$work/$face-$name.trace"
+	"$program" "$work/$face-$name.trace" > "$work/$face-$name.log"
+	printf "%s %s: " "$face" "$name"
+	python3 "$root/tools/event_trace.py" check --counts $update \
+		"$work/$face-$name.log" "$root/$face/test/$name.json" || failed=1
+}
+
+# frames FACE NAME SCREEN [cflags...]
+frames() {
+	face=$1
+	name=$2
+	screen=$3
+	shift 3
+	program=$work/$face-$name-$screen
+	log=$("$host/build.sh" -o "$program" "$face" -DFRAME_CAPTURE -DFRAME_CAPTURE_DUMP "$@" 2>&1) || {
+		echo "$log"
+		exit 1
+	}
+	python3 "$root/tools/event_trace.py" build "$root/$face/test/$name.txt" "$work/$face-$name.trace"
+	"$program" "$work/$face-$name.trace" > "$work/$face-$name-$screen.log"
+	printf "%s %s %s: " "$face" "$name" "$screen"
+	python3 "$root/tools/frame_capture.py" check $update \
+		"$work/$face-$name-$screen.log" "$root/$face/test/$name-$screen" || failed=1
+}
+
+replay natswatch day
+replay bluetoo flap
+frames natswatch frames rect
+frames natswatch frames round -DPBL_ROUND
+
+if [ $failed -ne 0 ]; then
+	echo "check: failed"
+	exit 1
+fi
+echo "check: all passed"
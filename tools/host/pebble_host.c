@@ -0,0 +1,1533 @@
+#include "pebble_host.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+
+// The shim itself allocates from the C library, and counts what it hands
+// the face through host_malloc
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+// ---- stats ----
+
+const char *host_call_names[HOST_CALL_COUNT] = {
+	"tick", "battery", "connection", "tap", "inbox", "outbox", "timer", "frame"
+};
+
+static HostStats s_stats;
+
+const HostStats *host_stats() {
+	return &s_stats;
+}
+
+static uint64_t cpu_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static uint64_t call_begin() {
+	return cpu_ns();
+}
+
+static void call_end(HostCall call, uint64_t start) {
+	uint64_t elapsed = cpu_ns() - start;
+	HostTiming *timing = &s_stats.timings[call];
+	timing->calls++;
+	timing->total_ns += elapsed;
+	timing->max_ns = MAX(timing->max_ns, elapsed);
+}
+
+// ---- logging ----
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+	const char *level = log_level <= APP_LOG_LEVEL_ERROR ? "E" :
+		log_level <= APP_LOG_LEVEL_WARNING ? "W" : log_level <= APP_LOG_LEVEL_INFO ? "I" : "D";
+	const char *name = strrchr(src_filename, '/');
+	printf("[%s] %s:%d> ", level, name ? name + 1 : src_filename, src_line_number);
+
+	va_list args;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+	putchar('\n');
+}
+
+// ---- heap ----
+
+// Each block starts with its size, so frees can be counted
+typedef union {
+	size_t size;
+	long double align;
+} BlockHeader;
+
+static size_t s_heap_used;
+
+void *host_malloc(size_t size) {
+	if(s_heap_used + size > HOST_HEAP_SIZE) {
+		return NULL;
+	}
+	BlockHeader *block = malloc(sizeof(BlockHeader) + size);
+	block->size = size;
+	s_heap_used += size;
+	s_stats.bytes_allocated += size;
+	s_stats.heap_peak = MAX(s_stats.heap_peak, s_heap_used);
+	return block + 1;
+}
+
+void *host_calloc(size_t count, size_t size) {
+	void *ptr = host_malloc(count * size);
+	if(ptr) {
+		memset(ptr, 0, count * size);
+	}
+	return ptr;
+}
+
+void host_free(void *ptr) {
+	if(!ptr) {
+		return;
+	}
+	BlockHeader *block = (BlockHeader *)ptr - 1;
+	s_heap_used -= block->size;
+	free(block);
+}
+
+void *host_realloc(void *ptr, size_t size) {
+	void *moved = host_malloc(size);
+	if(moved && ptr) {
+		memcpy(moved, ptr, MIN(size, ((BlockHeader *)ptr - 1)->size));
+		host_free(ptr);
+	}
+	return moved;
+}
+
+size_t heap_bytes_used() {
+	return s_heap_used;
+}
+
+size_t heap_bytes_free() {
+	return HOST_HEAP_SIZE - s_heap_used;
+}
+
+// ---- clock ----
+
+static int64_t s_now_ms;
+static bool s_24h_style = true;
+
+// The watch keeps local time. The host runs in UTC, so localtime() gives
+// back the clock a trace was recorded with.
+__attribute__((constructor)) static void use_utc() {
+	setenv("TZ", "UTC", 1);
+	tzset();
+}
+
+int64_t host_now_ms() {
+	return s_now_ms;
+}
+
+void host_set_time(time_t now) {
+	s_now_ms = (int64_t)now * 1000;
+}
+
+// Replaces the C library's time() for the face and the shim alike
+time_t time(time_t *tloc) {
+	time_t now = s_now_ms / 1000;
+	if(tloc) {
+		*tloc = now;
+	}
+	return now;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+	uint16_t millis = s_now_ms % 1000;
+	if(tloc) {
+		*tloc = s_now_ms / 1000;
+	}
+	if(out_ms) {
+		*out_ms = millis;
+	}
+	return millis;
+}
+
+bool clock_is_24h_style() {
+	return s_24h_style;
+}
+
+void host_set_24h_style(bool style_24h) {
+	s_24h_style = style_24h;
+}
+
+const char *i18n_get_system_locale() {
+	return "en_US";
+}
+
+// ---- geometry ----
+
+bool grect_equal(const GRect *rect_a, const GRect *rect_b) {
+	return rect_a->origin.x == rect_b->origin.x && rect_a->origin.y == rect_b->origin.y &&
+		rect_a->size.w == rect_b->size.w && rect_a->size.h == rect_b->size.h;
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+	return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+		point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+bool gcolor_equal(GColor8 color_a, GColor8 color_b) {
+	return color_a.argb == color_b.argb;
+}
+
+static GRect intersect(GRect a, GRect b) {
+	int x0 = MAX(a.origin.x, b.origin.x);
+	int y0 = MAX(a.origin.y, b.origin.y);
+	int x1 = MIN(a.origin.x + a.size.w, b.origin.x + b.size.w);
+	int y1 = MIN(a.origin.y + a.size.h, b.origin.y + b.size.h);
+	return GRect(x0, y0, MAX(x1 - x0, 0), MAX(y1 - y0, 0));
+}
+
+// ---- frame buffer ----
+
+struct GBitmap {
+	uint8_t *data;
+	uint16_t row_size;
+	GRect bounds;
+	GBitmapFormat format;
+	bool owns_data;
+};
+
+static uint8_t s_frame_buffer[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+static uint8_t s_previous_frame[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+
+// visible pixels of each row, all of them on a rectangular screen
+static int16_t s_row_min_x[HOST_SCREEN_HEIGHT];
+static int16_t s_row_max_x[HOST_SCREEN_HEIGHT];
+
+__attribute__((constructor)) static void init_rows() {
+	for(int y = 0; y < HOST_SCREEN_HEIGHT; y++) {
+#ifdef PBL_ROUND
+		double radius = HOST_SCREEN_WIDTH / 2.0;
+		double dy = y + 0.5 - radius;
+		int half = (int)sqrt(radius * radius - dy * dy);
+		s_row_min_x[y] = HOST_SCREEN_WIDTH / 2 - half;
+		s_row_max_x[y] = HOST_SCREEN_WIDTH / 2 + half - 1;
+#else
+		s_row_min_x[y] = 0;
+		s_row_max_x[y] = HOST_SCREEN_WIDTH - 1;
+#endif
+	}
+}
+
+static GBitmap s_frame_bitmap = {
+	.data = &s_frame_buffer[0][0],
+	.row_size = HOST_SCREEN_WIDTH,
+	.bounds = { { 0, 0 }, { HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT } },
+	.format = GBitmapFormat8Bit
+};
+
+const uint8_t *host_frame_buffer() {
+	return &s_frame_buffer[0][0];
+}
+
+// ---- bitmaps ----
+
+static GBitmap *create_bitmap(GSize size, GBitmapFormat format) {
+	GBitmap *bitmap = host_calloc(1, sizeof(GBitmap));
+	if(!bitmap) {
+		return NULL;
+	}
+	bitmap->row_size = format == GBitmapFormat1Bit ? (size.w + 31) / 32 * 4 : size.w;
+	bitmap->bounds = GRect(0, 0, size.w, size.h);
+	bitmap->format = format;
+	bitmap->data = host_calloc(size.h, bitmap->row_size);
+	if(!bitmap->data) {
+		host_free(bitmap);
+		return NULL;
+	}
+	bitmap->owns_data = true;
+	return bitmap;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+	return create_bitmap(size, format);
+}
+
+// There is no PNG decoder, images draw as a grey square
+#define HOST_PLACEHOLDER_SIZE 24
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+	GBitmap *bitmap = create_bitmap(GSize(HOST_PLACEHOLDER_SIZE, HOST_PLACEHOLDER_SIZE), GBitmapFormat8Bit);
+	if(!bitmap) {
+		return NULL;
+	}
+	memset(bitmap->data, GColorLightGray.argb, HOST_PLACEHOLDER_SIZE * HOST_PLACEHOLDER_SIZE);
+	return bitmap;
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+	GBitmap *bitmap = host_malloc(sizeof(GBitmap));
+	if(!bitmap) {
+		return NULL;
+	}
+	*bitmap = *base_bitmap;
+	bitmap->bounds = intersect(sub_rect, base_bitmap->bounds);
+	bitmap->owns_data = false;
+	return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+	if(!bitmap) {
+		return;
+	}
+	if(bitmap->owns_data) {
+		host_free(bitmap->data);
+	}
+	host_free(bitmap);
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+	return bitmap->bounds;
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) {
+	return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+	return bitmap->row_size;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+	return bitmap->format;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y) {
+	GBitmapDataRowInfo info = { bitmap->data + y * bitmap->row_size, 0, bitmap->bounds.size.w - 1 };
+	if(bitmap == &s_frame_bitmap) {
+		info.min_x = s_row_min_x[y];
+		info.max_x = s_row_max_x[y];
+	}
+	return info;
+}
+
+// ---- drawing ----
+
+struct GContext {
+	GPoint offset;  // origin of the layer being drawn
+	GRect clip;  // in screen coordinates
+	GColor fill_color;
+	GColor stroke_color;
+	GColor text_color;
+	GCompOp compositing_mode;
+};
+
+static GContext s_context;
+
+static void put_pixel(GContext *ctx, int x, int y, GColor color) {
+	x += ctx->offset.x;
+	y += ctx->offset.y;
+	GRect clip = ctx->clip;
+	if(x < clip.origin.x || y < clip.origin.y || x >= clip.origin.x + clip.size.w ||
+			y >= clip.origin.y + clip.size.h || x < s_row_min_x[y] || x > s_row_max_x[y]) {
+		return;
+	}
+	s_frame_buffer[y][x] = color.argb;
+	s_stats.pixels_drawn++;
+}
+
+static void fill(GContext *ctx, GRect rect, GColor color) {
+	if(color.a == 0) {
+		return;
+	}
+	for(int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+		for(int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+			put_pixel(ctx, x, y, color);
+		}
+	}
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+	ctx->fill_color = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+	ctx->stroke_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+	ctx->text_color = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+	ctx->compositing_mode = mode;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+	fill(ctx, rect, ctx->fill_color);
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+	int dx = ABS(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+	int dy = -ABS(p1.y - p0.y), sy = p0.y < p1.y ? 1 : -1;
+	int error = dx + dy;
+	int x = p0.x, y = p0.y;
+	for(;;) {
+		put_pixel(ctx, x, y, ctx->stroke_color);
+		if(x == p1.x && y == p1.y) {
+			break;
+		}
+		if(2 * error >= dy) {
+			error += dy;
+			x += sx;
+		}
+		if(2 * error <= dx) {
+			error += dx;
+			y += sy;
+		}
+	}
+}
+
+// Bitmaps tile the rectangle. GCompOpSet leaves transparent pixels out.
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+	GRect source = bitmap->bounds;
+	if(source.size.w <= 0 || source.size.h <= 0) {
+		return;
+	}
+	for(int y = 0; y < rect.size.h; y++) {
+		const uint8_t *row = bitmap->data + (source.origin.y + y % source.size.h) * bitmap->row_size;
+		for(int x = 0; x < rect.size.w; x++) {
+			int sx = source.origin.x + x % source.size.w;
+			GColor color;
+			if(bitmap->format == GBitmapFormat1Bit) {
+				color = (row[sx / 8] >> (sx % 8)) & 1 ? GColorWhite : GColorBlack;
+			} else {
+				color.argb = row[sx];
+			}
+			if(ctx->compositing_mode == GCompOpSet && color.a == 0) {
+				continue;
+			}
+			put_pixel(ctx, rect.origin.x + x, rect.origin.y + y, color);
+		}
+	}
+}
+
+// ---- fonts and text ----
+
+// There are no font files on the host. Text draws as a box per glyph, as
+// wide and high as the font's size makes them, so layouts and redraw areas
+// still come out close to the watch. The box is striped with the bits of
+// the character, so a changed digit changes pixels as it would on the watch.
+struct HostFont {
+	int height;
+};
+
+#define HOST_SYSTEM_FONTS 16
+
+// one stripe per bit of a 7 bit character
+#define HOST_GLYPH_STRIPES 7
+
+static struct {
+	char key[48];
+	struct HostFont font;
+} s_system_fonts[HOST_SYSTEM_FONTS];
+
+// the size in a font's name, as in GOTHIC_28_BOLD
+static int font_height(const char *name) {
+	while(*name && !isdigit((unsigned char)*name)) {
+		name++;
+	}
+	return *name ? atoi(name) : 14;
+}
+
+static int glyph_advance(GFont font) {
+	return MAX(font->height / 2, 1);
+}
+
+GFont fonts_get_system_font(const char *font_key) {
+	for(int i = 0; i < HOST_SYSTEM_FONTS; i++) {
+		if(strcmp(s_system_fonts[i].key, font_key) == 0) {
+			return &s_system_fonts[i].font;
+		}
+		if(!s_system_fonts[i].key[0]) {
+			strncpy(s_system_fonts[i].key, font_key, sizeof(s_system_fonts[i].key) - 1);
+			s_system_fonts[i].font.height = font_height(font_key);
+			return &s_system_fonts[i].font;
+		}
+	}
+	abort();
+}
+
+static const char *s_resource_names[HOST_RESOURCE_COUNT];
+
+GFont fonts_load_custom_font(ResHandle handle) {
+	GFont font = host_malloc(sizeof(struct HostFont));
+	if(!font) {
+		return NULL;
+	}
+	font->height = font_height(handle < HOST_RESOURCE_COUNT ? s_resource_names[handle] : "");
+	return font;
+}
+
+void fonts_unload_custom_font(GFont font) {
+	host_free(font);
+}
+
+static int text_width(const char *text, GFont font) {
+	return strlen(text) * glyph_advance(font);
+}
+
+GSize graphics_text_layout_get_content_size(const char *text, GFont font, GRect box,
+		GTextOverflowMode overflow_mode, GTextAlignment alignment) {
+	if(!text || !*text) {
+		return GSize(0, 0);
+	}
+	return GSize(MIN(text_width(text, font), box.size.w), MIN(font->height, box.size.h));
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box,
+		GTextOverflowMode overflow_mode, GTextAlignment alignment, void *text_attributes) {
+	if(!text || !font) {
+		return;
+	}
+	// The faces were written against Aplite, which draws GColorClear text
+	// white, and several set it over black
+	GColor8 color = ctx->text_color.a == 0 ? GColorWhite : ctx->text_color;
+
+	GContext clipped = *ctx;
+	clipped.clip = intersect(ctx->clip, GRect(box.origin.x + ctx->offset.x, box.origin.y + ctx->offset.y,
+		box.size.w, box.size.h));
+
+	int advance = glyph_advance(font);
+	int x = box.origin.x;
+	if(alignment == GTextAlignmentCenter) {
+		x += (box.size.w - text_width(text, font)) / 2;
+	} else if(alignment == GTextAlignmentRight) {
+		x += box.size.w - text_width(text, font);
+	}
+
+	// the box of a glyph sits between the ascender and the baseline
+	int top = box.origin.y + font->height / 4;
+	int height = font->height * 5 / 8;
+	for(const char *c = text; *c; c++, x += advance) {
+		if(isspace((unsigned char)*c)) {
+			continue;
+		}
+		for(int bit = 0; bit < HOST_GLYPH_STRIPES; bit++) {
+			if(*c & (1 << bit)) {
+				int y = top + height * bit / HOST_GLYPH_STRIPES;
+				int next = top + height * (bit + 1) / HOST_GLYPH_STRIPES;
+				fill(&clipped, GRect(x + 1, y, advance - 2, MAX(next - y, 1)), color);
+			}
+		}
+	}
+}
+
+// ---- resources ----
+
+#define HOST_RESOURCE_NAME(name) [RESOURCE_ID_##name] = #name,
+static const char *s_resource_names[HOST_RESOURCE_COUNT] = {
+	HOST_RESOURCE_IDS(HOST_RESOURCE_NAME)
+};
+#undef HOST_RESOURCE_NAME
+
+static struct {
+	uint8_t *data;
+	size_t size;
+} s_resources[HOST_RESOURCE_COUNT];
+
+void host_set_resource_file(uint32_t resource_id, const char *path) {
+	FILE *file = fopen(path, "rb");
+	if(!file) {
+		perror(path);
+		exit(1);
+	}
+	fseek(file, 0, SEEK_END);
+	s_resources[resource_id].size = ftell(file);
+	s_resources[resource_id].data = malloc(s_resources[resource_id].size);
+	fseek(file, 0, SEEK_SET);
+	if(fread(s_resources[resource_id].data, 1, s_resources[resource_id].size, file) !=
+			s_resources[resource_id].size) {
+		perror(path);
+		exit(1);
+	}
+	fclose(file);
+}
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+	return resource_id;
+}
+
+size_t resource_size(ResHandle handle) {
+	return s_resources[handle].size;
+}
+
+size_t resource_load_byte_range(ResHandle handle, uint32_t start_offset, uint8_t *buffer, size_t num_bytes) {
+	size_t size = s_resources[handle].size;
+	if(start_offset >= size) {
+		return 0;
+	}
+	num_bytes = MIN(num_bytes, size - start_offset);
+	memcpy(buffer, s_resources[handle].data + start_offset, num_bytes);
+	return num_bytes;
+}
+
+size_t resource_load(ResHandle handle, uint8_t *buffer, size_t max_length) {
+	return resource_load_byte_range(handle, 0, buffer, max_length);
+}
+
+// ---- layers ----
+
+struct Layer {
+	GRect frame;
+	bool hidden;
+	LayerUpdateProc update_proc;
+	Layer *parent;
+	Layer *first_child;
+	Layer *next_sibling;
+	void *data;
+};
+
+struct TextLayer {
+	Layer layer;
+	const char *text;
+	GFont font;
+	GColor text_color;
+	GColor background_color;
+	GTextAlignment alignment;
+};
+
+struct BitmapLayer {
+	Layer layer;
+	const GBitmap *bitmap;
+	GCompOp compositing_mode;
+};
+
+struct Window {
+	Layer root_layer;
+	WindowHandlers handlers;
+	GColor background_color;
+	bool loaded;
+};
+
+static Window *s_window;  // the top of the window stack
+static bool s_dirty;
+
+static void mark_dirty() {
+	s_dirty = true;
+}
+
+static void init_layer(Layer *layer, GRect frame) {
+	memset(layer, 0, sizeof(Layer));
+	layer->frame = frame;
+}
+
+Layer *layer_create(GRect frame) {
+	Layer *layer = host_malloc(sizeof(Layer));
+	if(!layer) {
+		return NULL;
+	}
+	init_layer(layer, frame);
+	return layer;
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+	Layer *layer = host_malloc(sizeof(Layer) + data_size);
+	if(!layer) {
+		return NULL;
+	}
+	init_layer(layer, frame);
+	layer->data = layer + 1;
+	memset(layer->data, 0, data_size);
+	return layer;
+}
+
+void layer_remove_from_parent(Layer *child) {
+	Layer *parent = child->parent;
+	if(!parent) {
+		return;
+	}
+	for(Layer **link = &parent->first_child; *link; link = &(*link)->next_sibling) {
+		if(*link == child) {
+			*link = child->next_sibling;
+			break;
+		}
+	}
+	child->parent = NULL;
+	child->next_sibling = NULL;
+	mark_dirty();
+}
+
+static void remove_children(Layer *layer) {
+	while(layer->first_child) {
+		layer_remove_from_parent(layer->first_child);
+	}
+}
+
+void layer_destroy(Layer *layer) {
+	if(!layer) {
+		return;
+	}
+	layer_remove_from_parent(layer);
+	remove_children(layer);
+	host_free(layer);
+}
+
+void *layer_get_data(const Layer *layer) {
+	return layer->data;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+	layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer) {
+	s_stats.mark_dirty++;
+	mark_dirty();
+}
+
+// Later children draw over earlier ones
+void layer_add_child(Layer *parent, Layer *child) {
+	layer_remove_from_parent(child);
+	Layer **link = &parent->first_child;
+	while(*link) {
+		link = &(*link)->next_sibling;
+	}
+	*link = child;
+	child->parent = parent;
+	mark_dirty();
+}
+
+void layer_insert_below_sibling(Layer *layer_to_insert, Layer *below_sibling_layer) {
+	Layer *parent = below_sibling_layer->parent;
+	layer_remove_from_parent(layer_to_insert);
+	Layer **link = &parent->first_child;
+	while(*link != below_sibling_layer) {
+		link = &(*link)->next_sibling;
+	}
+	layer_to_insert->next_sibling = below_sibling_layer;
+	*link = layer_to_insert;
+	layer_to_insert->parent = parent;
+	mark_dirty();
+}
+
+void layer_insert_above_sibling(Layer *layer_to_insert, Layer *above_sibling_layer) {
+	layer_remove_from_parent(layer_to_insert);
+	layer_to_insert->next_sibling = above_sibling_layer->next_sibling;
+	above_sibling_layer->next_sibling = layer_to_insert;
+	layer_to_insert->parent = above_sibling_layer->parent;
+	mark_dirty();
+}
+
+GRect layer_get_frame(const Layer *layer) {
+	return layer->frame;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+	layer->frame = frame;
+	mark_dirty();
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+	return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+	if(layer->hidden != hidden) {
+		layer->hidden = hidden;
+		mark_dirty();
+	}
+}
+
+bool layer_get_hidden(const Layer *layer) {
+	return layer->hidden;
+}
+
+// ---- text layers ----
+
+static void text_layer_update_proc(Layer *layer, GContext *ctx) {
+	TextLayer *text_layer = (TextLayer *)layer;
+	GRect bounds = layer_get_bounds(layer);
+	fill(ctx, bounds, text_layer->background_color);
+	graphics_context_set_text_color(ctx, text_layer->text_color);
+	graphics_draw_text(ctx, text_layer->text, text_layer->font, bounds,
+		GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+}
+
+TextLayer *text_layer_create(GRect frame) {
+	TextLayer *text_layer = host_calloc(1, sizeof(TextLayer));
+	if(!text_layer) {
+		return NULL;
+	}
+	init_layer(&text_layer->layer, frame);
+	text_layer->layer.update_proc = text_layer_update_proc;
+	text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+	text_layer->text_color = GColorBlack;
+	text_layer->background_color = GColorWhite;
+	text_layer->alignment = GTextAlignmentLeft;
+	return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+	layer_destroy(&text_layer->layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+	return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+	s_stats.set_text++;
+	text_layer->text = text;
+	mark_dirty();
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+	return text_layer->text;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+	text_layer->background_color = color;
+	mark_dirty();
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+	text_layer->text_color = color;
+	mark_dirty();
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+	text_layer->font = font;
+	mark_dirty();
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+	text_layer->alignment = text_alignment;
+	mark_dirty();
+}
+
+// ---- bitmap layers ----
+
+// The bitmap is centred in the layer
+static void bitmap_layer_update_proc(Layer *layer, GContext *ctx) {
+	BitmapLayer *bitmap_layer = (BitmapLayer *)layer;
+	if(!bitmap_layer->bitmap) {
+		return;
+	}
+	GRect bounds = layer_get_bounds(layer);
+	GSize size = bitmap_layer->bitmap->bounds.size;
+	GCompOp mode = ctx->compositing_mode;
+	ctx->compositing_mode = bitmap_layer->compositing_mode;
+	graphics_draw_bitmap_in_rect(ctx, bitmap_layer->bitmap,
+		GRect((bounds.size.w - size.w) / 2, (bounds.size.h - size.h) / 2, size.w, size.h));
+	ctx->compositing_mode = mode;
+}
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+	BitmapLayer *bitmap_layer = host_calloc(1, sizeof(BitmapLayer));
+	if(!bitmap_layer) {
+		return NULL;
+	}
+	init_layer(&bitmap_layer->layer, frame);
+	bitmap_layer->layer.update_proc = bitmap_layer_update_proc;
+	return bitmap_layer;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+	layer_destroy(&bitmap_layer->layer);
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) {
+	return (Layer *)&bitmap_layer->layer;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) {
+	bitmap_layer->bitmap = bitmap;
+	mark_dirty();
+}
+
+void bitmap_layer_set_compositing_mode(BitmapLayer *bitmap_layer, GCompOp mode) {
+	bitmap_layer->compositing_mode = mode;
+	mark_dirty();
+}
+
+// ---- windows ----
+
+Window *window_create() {
+	Window *window = host_calloc(1, sizeof(Window));
+	if(!window) {
+		return NULL;
+	}
+	init_layer(&window->root_layer, GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT));
+	window->background_color = GColorWhite;
+	return window;
+}
+
+void window_destroy(Window *window) {
+	if(window->loaded && window->handlers.unload) {
+		window->handlers.unload(window);
+	}
+	remove_children(&window->root_layer);
+	if(s_window == window) {
+		s_window = NULL;
+	}
+	host_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+	window->handlers = handlers;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+	window->background_color = background_color;
+	mark_dirty();
+}
+
+Layer *window_get_root_layer(const Window *window) {
+	return (Layer *)&window->root_layer;
+}
+
+bool window_is_loaded(Window *window) {
+	return window->loaded;
+}
+
+void window_stack_push(Window *window, bool animated) {
+	s_window = window;
+	if(!window->loaded) {
+		window->loaded = true;
+		if(window->handlers.load) {
+			window->handlers.load(window);
+		}
+	}
+	if(window->handlers.appear) {
+		window->handlers.appear(window);
+	}
+	mark_dirty();
+}
+
+// ---- rendering ----
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+	return &s_frame_bitmap;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+	return true;
+}
+
+static void draw_layer(Layer *layer, GPoint origin, GRect clip) {
+	if(layer->hidden) {
+		return;
+	}
+	origin.x += layer->frame.origin.x;
+	origin.y += layer->frame.origin.y;
+	clip = intersect(clip, GRect(origin.x, origin.y, layer->frame.size.w, layer->frame.size.h));
+
+	if(layer->update_proc) {
+		s_context = (GContext) {
+			.offset = origin,
+			.clip = clip,
+			.fill_color = GColorBlack,
+			.stroke_color = GColorBlack,
+			.text_color = GColorBlack,
+			.compositing_mode = GCompOpAssign
+		};
+		layer->update_proc(layer, &s_context);
+	}
+	for(Layer *child = layer->first_child; child; child = child->next_sibling) {
+		draw_layer(child, origin, clip);
+	}
+}
+
+// Like the watch, every frame draws the whole window. A clear background
+// leaves the frame before in the frame buffer.
+bool host_render() {
+	if(!s_dirty || !s_window) {
+		return false;
+	}
+	s_dirty = false;
+
+	uint64_t start = call_begin();
+	GRect screen = GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT);
+	s_context = (GContext) { .offset = GPointZero, .clip = screen };
+	fill(&s_context, screen, s_window->background_color);
+	draw_layer(&s_window->root_layer, GPointZero, screen);
+	call_end(HOST_CALL_FRAME, start);
+
+	s_stats.frames++;
+	for(int y = 0; y < HOST_SCREEN_HEIGHT; y++) {
+		for(int x = s_row_min_x[y]; x <= s_row_max_x[y]; x++) {
+			s_stats.pixels_changed += s_frame_buffer[y][x] != s_previous_frame[y][x];
+		}
+	}
+	memcpy(s_previous_frame, s_frame_buffer, sizeof(s_frame_buffer));
+	return true;
+}
+
+// ---- timers ----
+
+struct AppTimer {
+	int64_t due_ms;
+	uint32_t order;  // timers due together fire in the order they were set
+	AppTimerCallback callback;
+	void *data;
+	bool internal;  // the shim's own, not timed as the face's
+	AppTimer *next;
+};
+
+static AppTimer *s_timers;
+static uint32_t s_timer_order;
+
+static bool timer_live(AppTimer *timer) {
+	for(AppTimer *live = s_timers; live; live = live->next) {
+		if(live == timer) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void unlink_timer(AppTimer *timer) {
+	for(AppTimer **link = &s_timers; *link; link = &(*link)->next) {
+		if(*link == timer) {
+			*link = timer->next;
+			return;
+		}
+	}
+}
+
+static AppTimer *add_timer(uint32_t timeout_ms, AppTimerCallback callback, void *data, bool internal) {
+	AppTimer *timer = internal ? malloc(sizeof(AppTimer)) : host_malloc(sizeof(AppTimer));
+	*timer = (AppTimer) {
+		.due_ms = s_now_ms + timeout_ms,
+		.order = s_timer_order++,
+		.callback = callback,
+		.data = data,
+		.internal = internal,
+		.next = s_timers
+	};
+	s_timers = timer;
+	return timer;
+}
+
+static void free_timer(AppTimer *timer) {
+	if(timer->internal) {
+		free(timer);
+	} else {
+		host_free(timer);
+	}
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+	return add_timer(timeout_ms, callback, callback_data, false);
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+	if(!timer_live(timer_handle)) {
+		return false;
+	}
+	timer_handle->due_ms = s_now_ms + new_timeout_ms;
+	timer_handle->order = s_timer_order++;
+	return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+	if(timer_live(timer_handle)) {
+		unlink_timer(timer_handle);
+		free_timer(timer_handle);
+	}
+}
+
+static AppTimer *next_timer(int64_t until_ms) {
+	AppTimer *next = NULL;
+	for(AppTimer *timer = s_timers; timer; timer = timer->next) {
+		if(timer->due_ms <= until_ms && (!next || timer->due_ms < next->due_ms ||
+				(timer->due_ms == next->due_ms && timer->order < next->order))) {
+			next = timer;
+		}
+	}
+	return next;
+}
+
+void host_run_until(int64_t ms) {
+	host_render();
+	AppTimer *timer;
+	while((timer = next_timer(ms))) {
+		unlink_timer(timer);
+		s_now_ms = MAX(s_now_ms, timer->due_ms);
+		AppTimerCallback callback = timer->callback;
+		void *data = timer->data;
+		bool internal = timer->internal;
+		free_timer(timer);
+
+		uint64_t start = call_begin();
+		callback(data);
+		if(!internal) {
+			call_end(HOST_CALL_TIMER, start);
+		}
+		host_render();
+	}
+	s_now_ms = MAX(s_now_ms, ms);
+}
+
+// ---- services ----
+
+static TimeUnits s_tick_units;
+static TickHandler s_tick_handler;
+static BatteryStateHandler s_battery_handler;
+static BatteryChargeState s_battery = { .charge_percent = 80 };
+static ConnectionHandler s_connection_handler;
+static bool s_connected = true;
+static AccelTapHandler s_tap_handler;
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+	s_tick_units = tick_units;
+	s_tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe() {
+	s_tick_units = 0;
+	s_tick_handler = NULL;
+}
+
+TimeUnits host_tick_units() {
+	return s_tick_handler ? s_tick_units : 0;
+}
+
+void host_tick(struct tm *tick_time, TimeUnits units_changed) {
+	if(!s_tick_handler || !(units_changed & s_tick_units)) {
+		return;
+	}
+	uint64_t start = call_begin();
+	s_tick_handler(tick_time, units_changed);
+	call_end(HOST_CALL_TICK, start);
+	host_render();
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+	s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe() {
+	s_battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek() {
+	return s_battery;
+}
+
+void host_battery(BatteryChargeState state) {
+	s_battery = state;
+	if(!s_battery_handler) {
+		return;
+	}
+	uint64_t start = call_begin();
+	s_battery_handler(state);
+	call_end(HOST_CALL_BATTERY, start);
+	host_render();
+}
+
+void connection_service_subscribe(ConnectionHandlers conn_handlers) {
+	s_connection_handler = conn_handlers.pebble_app_connection_handler;
+}
+
+void connection_service_unsubscribe() {
+	s_connection_handler = NULL;
+}
+
+bool connection_service_peek_pebble_app_connection() {
+	return s_connected;
+}
+
+void host_connection(bool connected) {
+	s_connected = connected;
+	if(!s_connection_handler) {
+		return;
+	}
+	uint64_t start = call_begin();
+	s_connection_handler(connected);
+	call_end(HOST_CALL_CONNECTION, start);
+	host_render();
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+	s_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe() {
+	s_tap_handler = NULL;
+}
+
+void host_tap(AccelAxisType axis, int32_t direction) {
+	if(!s_tap_handler) {
+		return;
+	}
+	uint64_t start = call_begin();
+	s_tap_handler(axis, direction);
+	call_end(HOST_CALL_TAP, start);
+	host_render();
+}
+
+void vibes_short_pulse() {
+	s_stats.vibes++;
+	s_stats.vibe_ms += HOST_SHORT_PULSE_MS;
+}
+
+void vibes_long_pulse() {
+	s_stats.vibes++;
+	s_stats.vibe_ms += HOST_LONG_PULSE_MS;
+}
+
+void vibes_double_pulse() {
+	s_stats.vibes++;
+	s_stats.vibe_ms += HOST_DOUBLE_PULSE_MS;
+}
+
+// ---- dictionaries ----
+
+#define TUPLE_HEADER_SIZE 7
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+	uint32_t size = sizeof(Dictionary);
+	va_list sizes;
+	va_start(sizes, tuple_count);
+	for(int i = 0; i < tuple_count; i++) {
+		size += TUPLE_HEADER_SIZE + va_arg(sizes, uint32_t);
+	}
+	va_end(sizes);
+	return size;
+}
+
+uint32_t dict_size(DictionaryIterator *iter) {
+	return (const uint8_t *)iter->end - (const uint8_t *)iter->dictionary;
+}
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t *const buffer, const uint16_t size) {
+	if(!iter || !buffer || size < sizeof(Dictionary)) {
+		return DICT_INVALID_ARGS;
+	}
+	iter->dictionary = (Dictionary *)buffer;
+	iter->dictionary->count = 0;
+	iter->cursor = iter->dictionary->head;
+	iter->end = buffer + size;
+	return DICT_OK;
+}
+
+static DictionaryResult write_tuple(DictionaryIterator *iter, uint32_t key, TupleType type,
+		const void *data, uint16_t length) {
+	uint8_t *cursor = (uint8_t *)iter->cursor;
+	if(cursor + TUPLE_HEADER_SIZE + length > (const uint8_t *)iter->end) {
+		return DICT_NOT_ENOUGH_STORAGE;
+	}
+	iter->cursor->key = key;
+	iter->cursor->type = type;
+	iter->cursor->length = length;
+	memcpy(iter->cursor->value->data, data, length);
+	iter->cursor = (Tuple *)(cursor + TUPLE_HEADER_SIZE + length);
+	iter->dictionary->count++;
+	return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *const data, const uint16_t size) {
+	return write_tuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char *const cstring) {
+	return write_tuple(iter, key, TUPLE_CSTRING, cstring, strlen(cstring) + 1);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) {
+	return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value) {
+	return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value) {
+	return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+	return write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+	iter->end = iter->cursor;
+	return dict_size(iter);
+}
+
+static Tuple *tuple_at(const DictionaryIterator *iter, const uint8_t *position) {
+	const uint8_t *end = iter->end;
+	if(position + TUPLE_HEADER_SIZE > end || position + TUPLE_HEADER_SIZE + ((Tuple *)position)->length > end) {
+		return NULL;
+	}
+	return (Tuple *)position;
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t *const buffer, const uint16_t size) {
+	iter->dictionary = (Dictionary *)buffer;
+	iter->end = buffer + size;
+	return dict_read_first(iter);
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+	if(iter->dictionary->count == 0) {
+		iter->cursor = NULL;
+		return NULL;
+	}
+	iter->cursor = tuple_at(iter, (const uint8_t *)iter->dictionary->head);
+	return iter->cursor;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+	if(!iter->cursor) {
+		return NULL;
+	}
+	iter->cursor = tuple_at(iter, iter->cursor->value->data + iter->cursor->length);
+	return iter->cursor;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+	const uint8_t *position = (const uint8_t *)iter->dictionary->head;
+	for(int i = 0; i < iter->dictionary->count; i++) {
+		Tuple *tuple = tuple_at(iter, position);
+		if(!tuple) {
+			break;
+		}
+		if(tuple->key == key) {
+			return tuple;
+		}
+		position = tuple->value->data + tuple->length;
+	}
+	return NULL;
+}
+
+// ---- AppMessage ----
+
+static uint8_t *s_inbox;
+static uint8_t *s_outbox;
+static uint32_t s_inbox_size;
+static uint32_t s_outbox_size;
+static DictionaryIterator s_outbox_iterator;
+static bool s_outbox_open;  // outbox_begin was called
+static bool s_outbox_pending;  // sent, not acknowledged yet
+
+static AppMessageInboxReceived s_inbox_received;
+static AppMessageInboxDropped s_inbox_dropped;
+static AppMessageOutboxSent s_outbox_sent;
+static AppMessageOutboxFailed s_outbox_failed;
+static void (*s_outbox_handler)(DictionaryIterator *iterator);
+
+#define HOST_MESSAGE_SIZE_MAXIMUM 8200
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+	if(s_inbox) {
+		return APP_MSG_INVALID_ARGS;
+	}
+	s_inbox = host_malloc(size_inbound);
+	s_outbox = host_malloc(size_outbound);
+	if(!s_inbox || !s_outbox) {
+		return APP_MSG_OUT_OF_MEMORY;
+	}
+	s_inbox_size = size_inbound;
+	s_outbox_size = size_outbound;
+	return APP_MSG_OK;
+}
+
+uint32_t app_message_inbox_size_maximum() {
+	return HOST_MESSAGE_SIZE_MAXIMUM;
+}
+
+uint32_t app_message_outbox_size_maximum() {
+	return HOST_MESSAGE_SIZE_MAXIMUM;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+	AppMessageInboxReceived previous = s_inbox_received;
+	s_inbox_received = received_callback;
+	return previous;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+	AppMessageInboxDropped previous = s_inbox_dropped;
+	s_inbox_dropped = dropped_callback;
+	return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+	AppMessageOutboxSent previous = s_outbox_sent;
+	s_outbox_sent = sent_callback;
+	return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+	AppMessageOutboxFailed previous = s_outbox_failed;
+	s_outbox_failed = failed_callback;
+	return previous;
+}
+
+void host_set_outbox_handler(void (*handler)(DictionaryIterator *iterator)) {
+	s_outbox_handler = handler;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+	if(!s_outbox) {
+		return APP_MSG_INVALID_ARGS;
+	}
+	if(s_outbox_open || s_outbox_pending) {
+		return APP_MSG_BUSY;
+	}
+	dict_write_begin(&s_outbox_iterator, s_outbox, s_outbox_size);
+	s_outbox_open = true;
+	*iterator = &s_outbox_iterator;
+	return APP_MSG_OK;
+}
+
+// The phone acknowledges the message if it is there to receive it
+static void outbox_acknowledged(void *data) {
+	s_outbox_pending = false;
+	DictionaryIterator iterator;
+	dict_read_begin_from_buffer(&iterator, s_outbox, dict_size(&s_outbox_iterator));
+
+	uint64_t start = call_begin();
+	if(s_connected) {
+		if(s_outbox_sent) {
+			s_outbox_sent(&iterator, NULL);
+		}
+	} else if(s_outbox_failed) {
+		s_outbox_failed(&iterator, APP_MSG_NOT_CONNECTED, NULL);
+	}
+	call_end(HOST_CALL_OUTBOX, start);
+}
+
+AppMessageResult app_message_outbox_send() {
+	if(!s_outbox_open) {
+		return APP_MSG_INVALID_ARGS;
+	}
+	s_outbox_open = false;
+	s_outbox_pending = true;
+	uint32_t size = dict_write_end(&s_outbox_iterator);
+	s_stats.outbox_sends++;
+	s_stats.outbox_bytes += size;
+
+	if(s_outbox_handler) {
+		DictionaryIterator iterator;
+		dict_read_begin_from_buffer(&iterator, s_outbox, size);
+		s_outbox_handler(&iterator);
+	}
+	add_timer(HOST_MESSAGE_ACK_MS, outbox_acknowledged, NULL, true);
+	return APP_MSG_OK;
+}
+
+void host_inbox(const uint8_t *dictionary, uint16_t length) {
+	if(!s_inbox) {
+		return;
+	}
+
+	uint64_t start = call_begin();
+	if(length > s_inbox_size) {
+		if(s_inbox_dropped) {
+			s_inbox_dropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+		}
+	} else if(s_inbox_received) {
+		s_stats.inbox_messages++;
+		s_stats.inbox_bytes += length;
+		memcpy(s_inbox, dictionary, length);
+		DictionaryIterator iterator;
+		dict_read_begin_from_buffer(&iterator, s_inbox, length);
+		s_inbox_received(&iterator, NULL);
+	}
+	call_end(HOST_CALL_INBOX, start);
+	host_render();
+}
+
+// ---- persistent storage ----
+
+#define HOST_PERSIST_KEYS 64
+
+// negative StatusCodes of the SDK
+#define E_INVALID_ARGUMENT -2
+#define E_OUT_OF_STORAGE -6
+#define E_DOES_NOT_EXIST -4
+
+static struct {
+	bool used;
+	uint32_t key;
+	int size;
+	uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} s_persist[HOST_PERSIST_KEYS];
+
+static int persist_slot(uint32_t key) {
+	for(int i = 0; i < HOST_PERSIST_KEYS; i++) {
+		if(s_persist[i].used && s_persist[i].key == key) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool persist_exists(const uint32_t key) {
+	return persist_slot(key) >= 0;
+}
+
+int persist_get_size(const uint32_t key) {
+	int slot = persist_slot(key);
+	return slot < 0 ? E_DOES_NOT_EXIST : s_persist[slot].size;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+	int slot = persist_slot(key);
+	if(slot < 0) {
+		return E_DOES_NOT_EXIST;
+	}
+	int size = MIN((int)buffer_size, s_persist[slot].size);
+	memcpy(buffer, s_persist[slot].data, size);
+	return size;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+	int32_t value = 0;
+	persist_read_data(key, &value, sizeof(value));
+	return value;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+	if(size > PERSIST_DATA_MAX_LENGTH) {
+		return E_INVALID_ARGUMENT;
+	}
+	int slot = persist_slot(key);
+	for(int i = 0; slot < 0 && i < HOST_PERSIST_KEYS; i++) {
+		if(!s_persist[i].used) {
+			slot = i;
+		}
+	}
+	if(slot < 0) {
+		return E_OUT_OF_STORAGE;
+	}
+	s_persist[slot].used = true;
+	s_persist[slot].key = key;
+	s_persist[slot].size = size;
+	memcpy(s_persist[slot].data, data, size);
+	return size;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+	return persist_write_data(key, &value, sizeof(value)) < 0 ? E_OUT_OF_STORAGE : 0;
+}
+
+int persist_delete(const uint32_t key) {
+	int slot = persist_slot(key);
+	if(slot < 0) {
+		return E_DOES_NOT_EXIST;
+	}
+	s_persist[slot].used = false;
+	return 0;
+}
+
+// ---- app ----
+
+void app_event_loop() {
+	host_run_until(s_now_ms);
+	host_event_loop();
+}
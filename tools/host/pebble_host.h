@@ -0,0 +1,106 @@
+#pragma once
+#include <pebble.h>
+
+// What a host driver adds to the SDK shim. The face is built with main
+// renamed to face_main. Its app_event_loop() calls host_event_loop(),
+// which the driver defines and which feeds the face its events through
+// the functions below.
+
+int face_main(void);
+void host_event_loop(void);
+
+#ifdef PBL_ROUND
+#define HOST_SCREEN_WIDTH 180
+#define HOST_SCREEN_HEIGHT 180
+#else
+#define HOST_SCREEN_WIDTH 144
+#define HOST_SCREEN_HEIGHT 168
+#endif
+
+// the app heap of a Pebble Time, what heap_bytes_free counts down from
+#define HOST_HEAP_SIZE 65536
+
+// how long vibes_short_pulse, vibes_long_pulse and vibes_double_pulse run
+#define HOST_SHORT_PULSE_MS 100
+#define HOST_LONG_PULSE_MS 500
+#define HOST_DOUBLE_PULSE_MS 200
+
+// how long the phone takes to acknowledge a message
+#define HOST_MESSAGE_ACK_MS 200
+
+// What the face costs, counted from launch. Times are real CPU time on the
+// host, everything else is deterministic.
+typedef enum {
+	HOST_CALL_TICK,
+	HOST_CALL_BATTERY,
+	HOST_CALL_CONNECTION,
+	HOST_CALL_TAP,
+	HOST_CALL_INBOX,
+	HOST_CALL_OUTBOX,  // outbox sent and failed handlers
+	HOST_CALL_TIMER,
+	HOST_CALL_FRAME,  // a render pass of the window
+	HOST_CALL_COUNT
+} HostCall;
+
+typedef struct {
+	uint32_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+} HostTiming;
+
+typedef struct {
+	HostTiming timings[HOST_CALL_COUNT];
+	uint32_t set_text;
+	uint32_t mark_dirty;
+	uint32_t frames;
+	uint64_t pixels_drawn;  // written by fills, text, lines and bitmaps
+	uint64_t pixels_changed;  // differing from the frame before
+	uint32_t outbox_sends;
+	uint32_t outbox_bytes;
+	uint32_t inbox_messages;
+	uint32_t inbox_bytes;
+	uint32_t vibes;  // pulses, a double pulse is one
+	uint32_t vibe_ms;
+	uint64_t bytes_allocated;
+	size_t heap_peak;
+} HostStats;
+
+extern const char *host_call_names[HOST_CALL_COUNT];
+
+const HostStats *host_stats(void);
+
+// The simulated clock, in milliseconds since the epoch. time() and
+// time_ms() read it, and app timers fire on it.
+int64_t host_now_ms(void);
+void host_set_time(time_t now);
+
+// Fire the app timers due up to the time, drawing the window after each
+// callback that dirtied it, then move the clock there
+void host_run_until(int64_t ms);
+
+// Draw the window if anything marked it dirty. Returns whether it drew.
+bool host_render(void);
+
+// Deliver an event as the watch would, to whatever the face subscribed
+// or registered. A tick only reaches the face when units_changed has a
+// unit it subscribed to.
+void host_tick(struct tm *tick_time, TimeUnits units_changed);
+void host_battery(BatteryChargeState state);
+void host_connection(bool connected);
+void host_tap(AccelAxisType axis, int32_t direction);
+void host_inbox(const uint8_t *dictionary, uint16_t length);
+
+TimeUnits host_tick_units(void);
+
+// Called with every message the face sends, before it is acknowledged
+void host_set_outbox_handler(void (*handler)(DictionaryIterator *iterator));
+
+// The bytes of a resource, for resource_load and resource_load_byte_range.
+// Images without a file load as a grey placeholder.
+void host_set_resource_file(uint32_t resource_id, const char *path);
+
+// The frame buffer, HOST_SCREEN_WIDTH bytes of GColor8 per row
+const uint8_t *host_frame_buffer(void);
+
+// false to format the time as the 12 hour clock
+void host_set_24h_style(bool style_24h);
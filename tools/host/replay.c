@@ -0,0 +1,361 @@
+// Replay an event trace through a face built against the host shim, and
+// report what the face did and cost. See tools/event_trace.py for recording
+// and writing traces.
+//
+//   _host_build/natswatch/replay [--energy table] [--resource NAME=file] [--12h] trace
+//
+// The clock follows the trace. Battery, connection, tap and inbox events
+// are delivered when the trace has them. Tick events only move the clock:
+// the face gets a tick at every boundary of the units it is subscribed to
+// at that moment, so a build that sleeps or shows seconds gets the ticks
+// it would get on the watch. App timers fire on the same clock.
+//
+// The report lines start with "replay", which event_trace.py check
+// compares with a baseline. Counts are exact, times are host CPU time.
+#include "pebble_host.h"
+
+#undef malloc
+#undef free
+
+// ---- energy ----
+
+// Energy per operation in nAh, the same rough figures as the natswatch
+// bench, to compare builds with rather than predict battery life. A table
+// file overrides them, one "name value" per line.
+typedef struct {
+	const char *name;
+	double value;
+} EnergyCost;
+
+enum {
+	ENERGY_IDLE_PER_HOUR,
+	ENERGY_WAKEUP,
+	ENERGY_CPU_PER_MS,
+	ENERGY_CPU_SCALE,
+	ENERGY_RADIO_PER_MESSAGE,
+	ENERGY_VIBE_PER_MS,
+	ENERGY_DISPLAY_PER_MPIXEL,
+	ENERGY_COST_COUNT
+};
+
+static EnergyCost s_energy[ENERGY_COST_COUNT] = {
+	{ "idle_per_hour", 150000 },  // screen on, CPU asleep
+	{ "wakeup", 3 },  // dispatching one event to the face
+	{ "cpu_per_ms", 3 },  // running face code on the watch
+	{ "cpu_scale", 50 },  // how much slower the watch runs the face than this host
+	{ "radio_per_message", 300 },  // one AppMessage either way
+	{ "vibe_per_ms", 22 },  // the vibe motor
+	{ "display_per_mpixel", 60 }  // pushing changed pixels to the screen
+};
+
+static void read_energy(const char *path) {
+	FILE *file = fopen(path, "r");
+	if(!file) {
+		perror(path);
+		exit(1);
+	}
+	char line[128];
+	while(fgets(line, sizeof(line), file)) {
+		char name[64];
+		double value;
+		if(line[0] == '#' || sscanf(line, "%63s %lf", name, &value) != 2) {
+			continue;
+		}
+		int i = 0;
+		while(i < ENERGY_COST_COUNT && strcmp(s_energy[i].name, name) != 0) {
+			i++;
+		}
+		if(i == ENERGY_COST_COUNT) {
+			fprintf(stderr, "%s: unknown energy cost %s\n", path, name);
+			exit(1);
+		}
+		s_energy[i].value = value;
+	}
+	fclose(file);
+}
+
+// ---- trace ----
+
+// must match event_trace.h
+#define EVENT_TRACE_FORMAT_VERSION 1
+#define EVENT_TRACE_HEADER_SIZE 9
+
+enum {
+	EVENT_START,
+	EVENT_TICK,
+	EVENT_BATTERY,
+	EVENT_CONNECTION,
+	EVENT_TAP,
+	EVENT_INBOX
+};
+
+static uint8_t *s_trace;
+static size_t s_trace_size;
+static size_t s_cursor;
+static time_t s_start;
+static uint32_t s_events;
+static uint32_t s_wakeups;
+
+static void read_trace(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if(!file) {
+		perror(path);
+		exit(1);
+	}
+	fseek(file, 0, SEEK_END);
+	s_trace_size = ftell(file);
+	s_trace = malloc(s_trace_size);
+	fseek(file, 0, SEEK_SET);
+	if(fread(s_trace, 1, s_trace_size, file) != s_trace_size) {
+		perror(path);
+		exit(1);
+	}
+	fclose(file);
+
+	if(s_trace_size < EVENT_TRACE_HEADER_SIZE || s_trace[0] != 'E' || s_trace[1] != 'T' ||
+			s_trace[2] != EVENT_TRACE_FORMAT_VERSION || s_trace[3] != EVENT_START) {
+		fprintf(stderr, "%s: not a version %d event trace\n", path, EVENT_TRACE_FORMAT_VERSION);
+		exit(1);
+	}
+	s_start = s_trace[5] | s_trace[6] << 8 | s_trace[7] << 16 | (uint32_t)s_trace[8] << 24;
+	s_cursor = EVENT_TRACE_HEADER_SIZE;
+}
+
+static uint8_t next_byte() {
+	if(s_cursor >= s_trace_size) {
+		fprintf(stderr, "the trace ends inside an event\n");
+		exit(1);
+	}
+	return s_trace[s_cursor++];
+}
+
+static uint16_t next16() {
+	uint16_t low = next_byte();
+	return low | next_byte() << 8;
+}
+
+static uint32_t next_varint() {
+	uint32_t value = 0;
+	for(int shift = 0; ; shift += 7) {
+		uint8_t byte = next_byte();
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if(!(byte & 0x80)) {
+			return value;
+		}
+	}
+}
+
+// ---- ticks ----
+
+static time_t s_tick_clock;  // the last tick boundary passed
+static struct tm s_last_tick;
+
+static int unit_seconds(TimeUnits units) {
+	return units & SECOND_UNIT ? 1 : units & MINUTE_UNIT ? SECONDS_PER_MINUTE :
+		units & HOUR_UNIT ? SECONDS_PER_HOUR : SECONDS_PER_DAY;
+}
+
+static void deliver_tick(time_t now) {
+	struct tm tick_time = *localtime(&now);
+	TimeUnits changed = (tick_time.tm_sec != s_last_tick.tm_sec ? SECOND_UNIT : 0) |
+		(tick_time.tm_min != s_last_tick.tm_min ? MINUTE_UNIT : 0) |
+		(tick_time.tm_hour != s_last_tick.tm_hour ? HOUR_UNIT : 0) |
+		(tick_time.tm_mday != s_last_tick.tm_mday ? DAY_UNIT : 0) |
+		(tick_time.tm_mon != s_last_tick.tm_mon ? MONTH_UNIT : 0) |
+		(tick_time.tm_year != s_last_tick.tm_year ? YEAR_UNIT : 0);
+	s_last_tick = tick_time;
+	if(changed & host_tick_units()) {
+		s_wakeups++;
+		host_tick(&tick_time, changed);
+	}
+}
+
+// Run the face up to a time, ticking it on the way
+static void advance(time_t until) {
+	for(;;) {
+		TimeUnits units = host_tick_units();
+		if(!units) {
+			s_tick_clock = until;
+			break;
+		}
+		int step = unit_seconds(units);
+		time_t next = (s_tick_clock / step + 1) * step;
+		if(next > until) {
+			s_tick_clock = until;
+			break;
+		}
+		host_run_until(next * 1000LL);
+		s_tick_clock = next;
+		deliver_tick(next);
+	}
+	host_run_until(until * 1000LL);
+}
+
+static void replay_event() {
+	uint8_t type = next_byte();
+	time_t now = s_tick_clock + next_varint();
+	advance(now);
+	s_events++;
+
+	switch(type) {
+		case EVENT_START:
+			s_cursor += 4;
+			break;
+		case EVENT_TICK:
+			s_cursor += 10;
+			break;
+		case EVENT_BATTERY: {
+			uint8_t percent = next_byte();
+			uint8_t flags = next_byte();
+			s_wakeups++;
+			host_battery((BatteryChargeState) {
+				.charge_percent = percent,
+				.is_charging = flags & 1,
+				.is_plugged = (flags & 2) != 0
+			});
+			break;
+		}
+		case EVENT_CONNECTION:
+			s_wakeups++;
+			host_connection(next_byte());
+			break;
+		case EVENT_TAP: {
+			AccelAxisType axis = next_byte();
+			int32_t direction = (int8_t)next_byte();
+			s_wakeups++;
+			host_tap(axis, direction);
+			break;
+		}
+		case EVENT_INBOX: {
+			uint16_t length = next16();
+			if(s_cursor + length > s_trace_size) {
+				fprintf(stderr, "the trace ends inside an inbox message\n");
+				exit(1);
+			}
+			s_wakeups++;
+			host_inbox(s_trace + s_cursor, length);
+			s_cursor += length;
+			break;
+		}
+		default:
+			fprintf(stderr, "unknown event %d at byte %zu\n", type, s_cursor - 1);
+			exit(1);
+	}
+}
+
+// ---- report ----
+
+static void report_energy(time_t seconds) {
+	const HostStats *stats = host_stats();
+	double cpu_ms = 0;
+	for(int i = 0; i < HOST_CALL_COUNT; i++) {
+		cpu_ms += stats->timings[i].total_ns / 1e6;
+	}
+	uint32_t messages = stats->outbox_sends + stats->inbox_messages;
+	uint32_t wakeups = s_wakeups + stats->timings[HOST_CALL_TIMER].calls + stats->timings[HOST_CALL_OUTBOX].calls;
+
+	double parts[] = {
+		s_energy[ENERGY_IDLE_PER_HOUR].value * seconds / SECONDS_PER_HOUR,
+		s_energy[ENERGY_WAKEUP].value * wakeups,
+		s_energy[ENERGY_CPU_PER_MS].value * s_energy[ENERGY_CPU_SCALE].value * cpu_ms,
+		s_energy[ENERGY_RADIO_PER_MESSAGE].value * messages,
+		s_energy[ENERGY_VIBE_PER_MS].value * stats->vibe_ms,
+		s_energy[ENERGY_DISPLAY_PER_MPIXEL].value * stats->pixels_changed / 1e6
+	};
+	const char *names[] = { "idle", "wakeups", "cpu", "radio", "vibes", "display" };
+
+	double total = 0;
+	for(size_t i = 0; i < ARRAY_LENGTH(parts); i++) {
+		printf("energy %s: %.0f nAh\n", names[i], parts[i]);
+		total += parts[i];
+	}
+	printf("energy: %.3f mAh over %.1f hours, %.3f mAh/day\n", total / 1e6,
+		seconds / (double)SECONDS_PER_HOUR, seconds ? total / 1e6 * SECONDS_PER_DAY / seconds : 0);
+}
+
+static void report(time_t seconds) {
+	const HostStats *stats = host_stats();
+	printf("replay done: events=%lu seconds=%ld\n", (unsigned long)s_events, (long)seconds);
+	for(int i = 0; i < HOST_CALL_COUNT; i++) {
+		const HostTiming *timing = &stats->timings[i];
+		printf("replay %s: calls=%lu total_us=%llu max_us=%llu\n", host_call_names[i],
+			(unsigned long)timing->calls, (unsigned long long)(timing->total_ns / 1000),
+			(unsigned long long)(timing->max_ns / 1000));
+	}
+	printf("replay redraws: set_text=%lu mark_dirty=%lu frames=%lu\n", (unsigned long)stats->set_text,
+		(unsigned long)stats->mark_dirty, (unsigned long)stats->frames);
+	printf("replay pixels: drawn=%llu changed=%llu\n", (unsigned long long)stats->pixels_drawn,
+		(unsigned long long)stats->pixels_changed);
+	printf("replay radio: sends=%lu send_bytes=%lu received=%lu received_bytes=%lu\n",
+		(unsigned long)stats->outbox_sends, (unsigned long)stats->outbox_bytes,
+		(unsigned long)stats->inbox_messages, (unsigned long)stats->inbox_bytes);
+	printf("replay vibes: pulses=%lu ms=%lu\n", (unsigned long)stats->vibes, (unsigned long)stats->vibe_ms);
+	printf("replay heap: used=%lu peak=%lu allocated=%llu\n", (unsigned long)heap_bytes_used(),
+		(unsigned long)stats->heap_peak, (unsigned long long)stats->bytes_allocated);
+	report_energy(seconds);
+}
+
+// ---- main ----
+
+void host_event_loop() {
+	s_tick_clock = s_start;
+	s_last_tick = *localtime(&s_start);
+	while(s_cursor < s_trace_size) {
+		replay_event();
+	}
+	report(s_tick_clock - s_start);
+	fflush(stdout);
+}
+
+static void usage() {
+	fprintf(stderr, "usage: replay [--energy table] [--resource NAME=file] [--12h] trace\n");
+	exit(2);
+}
+
+#define RESOURCE_NAME(name) #name,
+static const char *s_resource_names[] = { "", HOST_RESOURCE_IDS(RESOURCE_NAME) };
+#undef RESOURCE_NAME
+
+static void set_resource(const char *argument) {
+	const char *path = strchr(argument, '=');
+	if(!path) {
+		usage();
+	}
+	for(uint32_t id = 1; id < HOST_RESOURCE_COUNT; id++) {
+		if(strncmp(s_resource_names[id], argument, path - argument) == 0 &&
+				!s_resource_names[id][path - argument]) {
+			host_set_resource_file(id, path + 1);
+			return;
+		}
+	}
+	fprintf(stderr, "unknown resource in %s\n", argument);
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	const char *trace = NULL;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--energy") == 0 && i + 1 < argc) {
+			read_energy(argv[++i]);
+		} else if(strcmp(argv[i], "--resource") == 0 && i + 1 < argc) {
+			set_resource(argv[++i]);
+		} else if(strcmp(argv[i], "--12h") == 0) {
+			host_set_24h_style(false);
+		} else if(argv[i][0] == '-' || trace) {
+			usage();
+		} else {
+			trace = argv[i];
+		}
+	}
+	if(!trace) {
+		usage();
+	}
+
+	// The face launches at the start of the trace
+	read_trace(trace);
+	host_set_time(s_start);
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	// Renamed, a face's main no longer returns 0 when it ends without return
+	face_main();
+	return 0;
+}
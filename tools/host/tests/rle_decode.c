@@ -0,0 +1,110 @@
+// Check that background.c decodes a resource from tools/rle_background.py
+// into the frame buffer pixel for pixel, or refuses a damaged one. Built
+// against a face with the background module, see rle_decode.sh:
+//
+//   _host_build/battlev/rle_decode background.rle expected.frame
+//   _host_build/battlev/rle_decode damaged.rle
+//
+// The expected frame is the decoded image as GColor8 bytes, a row of
+// HOST_SCREEN_WIDTH at a time. Without one the resource must draw nothing.
+#include "pebble_host.h"
+#include "background.h"
+
+#undef malloc
+#undef free
+
+// over the background on the first frame, hidden for the second
+#define COVER_RECT GRect(30, 40, 50, 60)
+#define COVER_COLOR ((GColor8){ .argb = 0xF0 })
+
+static uint8_t s_expected[HOST_SCREEN_HEIGHT][HOST_SCREEN_WIDTH];
+static bool s_damaged;
+static Layer *s_cover;
+static int s_failures;
+
+static void cover_update_proc(Layer *layer, GContext *ctx) {
+	graphics_context_set_fill_color(ctx, COVER_COLOR);
+	graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
+}
+
+// Compare the frame buffer with the expected frame as the layer above all
+// others draws, skipping the cover while it shows. A refused background
+// restores nothing, so the cover is skipped on both frames.
+static void probe_update_proc(Layer *layer, GContext *ctx) {
+	GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+	GRect cover = layer_get_hidden(s_cover) && !s_damaged ? GRectZero : COVER_RECT;
+	uint8_t first = gbitmap_get_data_row_info(frame_buffer, 0).data[HOST_SCREEN_WIDTH / 2];
+	int wrong = 0;
+
+	for(int y = 0; y < HOST_SCREEN_HEIGHT; y++) {
+		GBitmapDataRowInfo row = gbitmap_get_data_row_info(frame_buffer, y);
+		for(int x = row.min_x; x <= row.max_x; x++) {
+			if(grect_contains_point(&cover, &GPoint(x, y))) {
+				continue;
+			}
+			uint8_t expected = s_damaged ? first : s_expected[y][x];
+			if(row.data[x] != expected) {
+				if(!wrong) {
+					printf("pixel %d,%d is %02x, not %02x\n", x, y, row.data[x], expected);
+				}
+				wrong++;
+			}
+		}
+	}
+	graphics_release_frame_buffer(ctx, frame_buffer);
+
+	if(wrong) {
+		printf("%d wrong pixels with the cover %s\n", wrong, layer_get_hidden(s_cover) ? "hidden" : "shown");
+		s_failures++;
+	}
+}
+
+static void read_file(const char *path, void *buffer, size_t size) {
+	FILE *file = fopen(path, "rb");
+	if(!file || fread(buffer, 1, size, file) != size) {
+		fprintf(stderr, "%s: not a %zu byte frame\n", path, size);
+		exit(2);
+	}
+	fclose(file);
+}
+
+void host_event_loop() {
+}
+
+int main(int argc, char **argv) {
+	if(argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: rle_decode resource.rle [expected.frame]\n");
+		return 2;
+	}
+	s_damaged = argc == 2;
+	if(!s_damaged) {
+		read_file(argv[2], s_expected, sizeof(s_expected));
+	}
+	host_set_resource_file(RESOURCE_ID_BACKGROUND_RLE, argv[1]);
+
+	Window *window = window_create();
+	window_stack_push(window, false);
+	Layer *window_layer = window_get_root_layer(window);
+	background_load(window, RESOURCE_ID_BACKGROUND_RLE);
+
+	s_cover = layer_create(COVER_RECT);
+	layer_set_update_proc(s_cover, cover_update_proc);
+	layer_add_child(window_layer, s_cover);
+	Layer *probe = layer_create(layer_get_bounds(window_layer));
+	layer_set_update_proc(probe, probe_update_proc);
+	layer_add_child(window_layer, probe);
+	host_render();
+
+	// With BACKGROUND_CACHE only the uncovered area is decoded again
+	layer_set_hidden(s_cover, true);
+	background_mark_dirty(COVER_RECT);
+	host_render();
+
+	background_unload();
+	layer_destroy(probe);
+	layer_destroy(s_cover);
+	window_destroy(window);
+
+	printf("%s: %s\n", argv[1], s_failures ? "failed" : s_damaged ? "refused" : "decoded");
+	return s_failures ? 1 : 0;
+}
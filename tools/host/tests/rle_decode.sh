@@ -0,0 +1,95 @@
+#!/bin/sh
+# Encode test images with tools/rle_background.py and check that the
+# background.c of battlev decodes them into the frame buffer exactly as the
+# tool's reference decoder does, on rect and round screens, with and without
+# BACKGROUND_CACHE, and that damaged resources are refused.
+#
+#   tools/host/tests/rle_decode.sh
+
+set -e
+
+tests=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$tests/../../.." && pwd)
+work=$root/_host_build/rle_decode
+mkdir -p "$work"
+
+# Write an image of the screen size, its resource and expected frame, and
+# damaged copies of the resource
+make_resources() {
+	python3 - "$root/tools" "$work/$1" "$2" "$3" "$4" <<'EOF'
+import struct
+import sys
+
+sys.path.insert(0, sys.argv[1])
+from PIL import Image, ImageDraw
+import rle_background
+
+prefix, width, height, colors = sys.argv[2], int(sys.argv[3]), int(sys.argv[4]), int(sys.argv[5])
+
+# long runs, single pixel runs and every palette index
+image = Image.new("RGB", (width, height), (0, 0, 0))
+draw = ImageDraw.Draw(image)
+draw.ellipse((10, 20, width - 10, height - 30), fill=(255, 255, 255))
+draw.rectangle((0, height // 2, width // 3, height - 1), fill=(0, 0, 255))
+for x in range(0, width, 3):
+	draw.line((x, 0, x, 12), fill=(0, 170, 0))
+image.save(prefix + ".png")
+
+palette, pixels = rle_background.quantize(image, colors)
+blob = rle_background.encode(palette, pixels)
+with open(prefix + ".rle", "wb") as f:
+	f.write(blob)
+with open(prefix + ".frame", "wb") as f:
+	for row in rle_background.decode(blob):
+		f.write(bytes(palette[index] for index in row))
+
+table = rle_background.HEADER_SIZE
+
+# 3 bits per pixel
+with open(prefix + ".bits.rle", "wb") as f:
+	f.write(blob[:3] + b"\x03" + blob[4:])
+
+# the first row longer than the row buffer
+long_row = bytearray(blob)
+struct.pack_into("<H", long_row, table + 2, rle_background.ROW_BUFFER_SIZE + 1)
+with open(prefix + ".long.rle", "wb") as f:
+	f.write(long_row)
+
+# the row table cut short
+with open(prefix + ".short.rle", "wb") as f:
+	f.write(blob[:table + height])
+EOF
+}
+
+check() {
+	name=$1
+	shift
+	program=$work/$name
+	log=$("$root/tools/host/build.sh" -d "$tests/rle_decode.c" -o "$program" battlev "$@" 2>&1) || {
+		echo "$log"
+		exit 1
+	}
+	case "$*" in
+		*PBL_ROUND*) image=round ;;
+		*) image=rect ;;
+	esac
+	for resource in "$image" "$image-1bit"; do
+		"$program" "$work/$resource.rle" "$work/$resource.frame"
+		for damage in bits long short; do
+			# leave out the face's error log
+			"$program" "$work/$resource.$damage.rle" > "$work/$name.log"
+			grep -v "^\[" "$work/$name.log"
+		done
+	done
+}
+
+make_resources rect 144 168 4
+make_resources rect-1bit 144 168 2
+make_resources round 180 180 4
+make_resources round-1bit 180 180 2
+
+check rect
+check rect-cache -DBACKGROUND_CACHE
+check round -DPBL_ROUND
+check round-cache -DPBL_ROUND -DBACKGROUND_CACHE
+echo "rle decode: all passed"
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+# Convert a background image into the run-length encoded resource that
+# background.c in the bitmap faces decodes row by row into the frame buffer.
+#
+# The image is reduced to at most 4 colours from the Pebble 64 colour
+# palette. Layout of the output, all numbers little endian:
+#
+#   [0..1]   "RL"
+#   [2]      format version
+#   [3]      bits per pixel of the palette index, 1 or 2
+#   [4..5]   width, [6..7] height
+#   [8..11]  palette, one GColor8 (0b11rrggbb) per index
+#   [12..]   height + 1 uint16 offsets of each row into the run data
+#   then the runs: one byte each, palette index in the top 2 bits and
+#   run length - 1 in the low 6 bits. Runs never cross rows.
+#
+#   python3 tools/rle_background.py battlev/resources/images/background.png \
+#       battlev/resources/data/background.rle
+#
+# The output is decoded again and compared with the image before it is
+# written, and the heap needed is printed next to a full depth GBitmap.
+
+import argparse
+import struct
+import sys
+
+from PIL import Image
+
+FORMAT_VERSION = 1
+MAX_COLORS = 4
+MAX_RUN = 64
+HEADER_SIZE = 12
+
+# must match RLE_ROW_BUFFER_SIZE in background.c
+ROW_BUFFER_SIZE = 256
+
+
+def pebble_color(rgb):
+	# nearest of the 64 colours, 2 bits per channel
+	r, g, b = (int(round(c / 85.0)) for c in rgb)
+	return 0xC0 | (r << 4) | (g << 2) | b
+
+
+def quantize(image, colors):
+	image = image.convert("RGB").quantize(colors=colors)
+	rgb = image.getpalette()[:3 * colors]
+	palette = [pebble_color(rgb[i:i + 3]) for i in range(0, len(rgb), 3)]
+
+	# colours that collapse together on the watch share an index
+	unique = sorted(set(palette))
+	remap = [unique.index(c) for c in palette]
+	width, height = image.size
+	data = image.load()
+	pixels = [[remap[data[x, y]] for x in range(width)] for y in range(height)]
+	return unique, pixels
+
+
+def encode_row(row):
+	runs = bytearray()
+	x = 0
+	while x < len(row):
+		index = row[x]
+		length = 1
+		while x + length < len(row) and row[x + length] == index and length < MAX_RUN:
+			length += 1
+		runs.append(index << 6 | (length - 1))
+		x += length
+	return runs
+
+
+def encode(palette, pixels):
+	width, height = len(pixels[0]), len(pixels)
+	bits = 1 if len(palette) <= 2 else 2
+
+	offsets = []
+	runs = bytearray()
+	for row in pixels:
+		encoded = encode_row(row)
+		if len(encoded) > ROW_BUFFER_SIZE:
+			sys.exit("a row needs %d bytes, more than the %d byte row buffer"
+				% (len(encoded), ROW_BUFFER_SIZE))
+		offsets.append(len(runs))
+		runs += encoded
+	offsets.append(len(runs))
+	if len(runs) > 0xFFFF:
+		sys.exit("%d bytes of runs do not fit 16 bit row offsets" % len(runs))
+
+	padded = palette + [palette[0]] * (MAX_COLORS - len(palette))
+	header = struct.pack("<2sBBHH4B", b"RL", FORMAT_VERSION, bits, width, height, *padded)
+	table = struct.pack("<%dH" % len(offsets), *offsets)
+	return header + table + bytes(runs)
+
+
+# Reference decoder, the same steps as background.c
+def decode(blob):
+	magic, version, bits, width, height = struct.unpack_from("<2sBBHH", blob)
+	if magic != b"RL" or version != FORMAT_VERSION or bits not in (1, 2):
+		raise ValueError("not a version %d RL background" % FORMAT_VERSION)
+	offsets = struct.unpack_from("<%dH" % (height + 1), blob, HEADER_SIZE)
+	start = HEADER_SIZE + 2 * (height + 1)
+
+	pixels = []
+	for y in range(height):
+		if not 0 <= offsets[y + 1] - offsets[y] <= ROW_BUFFER_SIZE:
+			raise ValueError("row %d does not fit the row buffer" % y)
+		row = []
+		for byte in blob[start + offsets[y]:start + offsets[y + 1]]:
+			row += [byte >> 6] * ((byte & 0x3F) + 1)
+		if len(row) != width:
+			raise ValueError("row %d decodes to %d pixels, not %d" % (y, len(row), width))
+		pixels.append(row)
+	return pixels
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Encode a background image for streaming decode")
+	parser.add_argument("image", help="background PNG")
+	parser.add_argument("output", help="resource file to write")
+	parser.add_argument("--colors", type=int, default=MAX_COLORS, choices=range(2, MAX_COLORS + 1),
+		help="palette size, 2 gives a 1 bit image")
+	args = parser.parse_args()
+
+	palette, pixels = quantize(Image.open(args.image), args.colors)
+	blob = encode(palette, pixels)
+	if decode(blob) != pixels:
+		sys.exit("decoded image does not match")
+
+	with open(args.output, "wb") as f:
+		f.write(blob)
+
+	width, height = len(pixels[0]), len(pixels)
+	full_depth = width * height
+	streaming = 2 * (height + 1)
+	print("%s: %dx%d, %d colours, %d byte resource" % (args.output, width, height, len(palette), len(blob)))
+	print("heap: %d bytes as an 8 bit GBitmap, %d bytes of row table, %d saved"
+		% (full_depth, streaming, full_depth - streaming))
+
+
+if __name__ == "__main__":
+	main()
@@ -1,4 +1,8 @@
 #include <pebble.h>
+#include "event_trace.h"
+#include "frame_capture.h"
+#include "heap_trace.h"
+#include "time_format.h"
 
 // static pointer to a Window variable, to access later in init()
 static Window *s_main_window;
@@ -8,45 +12,45 @@ static TextLayer *s_time_layer;
 static TextLayer *s_day_layer;  // this will be for the day of the week
 static TextLayer *s_date_layer;  // to hold the date
 
-static void update_time() {
-	// Get a tm structure
-	time_t temp = time(NULL);
-	struct tm *tick_time = localtime(&temp);
-	
-	//Write the current hours and minutes into a buffer
-	static char s_buffer[8];  // buffer for hours and minutes
-	static char s_daybuffer[10];  // buffer for day of week
-	static char s_datebuffer[16]; // buffer for month day
-	
-	strftime(s_daybuffer, sizeof(s_daybuffer), "%A", tick_time); // full day format
-	text_layer_set_text(s_day_layer, s_daybuffer);
-		
-	strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ? "%H:%M" : "%l:%M", tick_time); 
-	text_layer_set_text(s_time_layer, s_buffer); // display this time on text_layer
+// text of the fields, reformatted when the tm members behind them change
+static TimeFormatter s_time_format;
 
-	strftime(s_datebuffer, sizeof(s_datebuffer), "%B %e", tick_time); // date
-	text_layer_set_text(s_date_layer, s_datebuffer);
+// Redraw only the fields whose text was rewritten, time_format_update finds
+// them from the tm members alone
+static void update_time(struct tm *tick_time) {
+	int changed = time_format_update(&s_time_format, tick_time);
 	
+	if(changed & TIME_FORMAT_DAY) {
+		text_layer_set_text(s_day_layer, s_time_format.day);
+	}
+	if(changed & TIME_FORMAT_DATE) {
+		text_layer_set_text(s_date_layer, s_time_format.date);
+	}
+	if(changed & TIME_FORMAT_TIME) {
+		text_layer_set_text(s_time_layer, s_time_format.time);
+	}
 }
 
 // start TickTimerService event service. struct tm contains the current time
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
-	update_time();
+	update_time(tick_time);
 }
 
 // handler function
 static void main_window_load(Window *window) {
+	heap_trace_point(HEAP_LOAD_START);
+	
 	// Get information about the Window
 	Layer *window_layer = window_get_root_layer(window);
 	GRect bounds = layer_get_bounds(window_layer);
 	
 	// Create the TextLayer with specific bounds
-	s_day_layer = text_layer_create(
-		GRect(0, 2, bounds.size.w, 36));
-	s_time_layer = text_layer_create(
-		GRect(0, 36, bounds.size.w, 50));
-	s_date_layer = text_layer_create(
-		GRect(0, 80, bounds.size.w, 36));
+	s_day_layer = HEAP_TRACE_OBJECT("day layer", text_layer_create(
+		GRect(0, 2, bounds.size.w, 36)));
+	s_time_layer = HEAP_TRACE_OBJECT("time layer", text_layer_create(
+		GRect(0, 36, bounds.size.w, 50)));
+	s_date_layer = HEAP_TRACE_OBJECT("date layer", text_layer_create(
+		GRect(0, 80, bounds.size.w, 36)));
 	
 	text_layer_set_background_color(s_day_layer, GColorBlack);
 	text_layer_set_text_color(s_day_layer, GColorClear);
@@ -69,17 +73,29 @@ static void main_window_load(Window *window) {
 	layer_add_child(window_layer, text_layer_get_layer(s_day_layer));
 	layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
 	layer_add_child(window_layer, text_layer_get_layer(s_date_layer));
+	
+	frame_capture_load(window_get_root_layer(window));
+	
+	heap_trace_point(HEAP_LOAD_END);
 }
 
 // handler function
 static void main_window_unload(Window *window) {
+	heap_trace_point(HEAP_UNLOAD_START);
+	frame_capture_unload();
+	
 	// Destroy TextLayer
 	text_layer_destroy(s_day_layer);
 	text_layer_destroy(s_time_layer);
 	text_layer_destroy(s_date_layer);
+	
+	heap_trace_point(HEAP_UNLOAD_END);
 }
 
 static void init() {
+	// Read the 12/24 hour setting once
+	time_format_init(&s_time_format, ' ');
+	
 	// Create main Window element and assign to pointer
 	s_main_window = window_create();
 	
@@ -96,7 +112,8 @@ static void init() {
 	tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
 	
 	// Make sure the time is displayed from the start
-	update_time();
+	time_t temp = time(NULL);
+	update_time(localtime(&temp));
 }
 
 static void deinit() {